@@ -4,21 +4,38 @@
 int screenWidth  = 1280;
 int screenHeight = 900;
 
-struct Position final : secs::Component
+struct Position
 {
-    Position(const int x, const int y) : x(x), y(y) { }
-
     int x, y;
 };
 
-struct Velocity final : secs::Component
+struct Velocity
 {
-    Velocity(const float vx, const float vy) : vx(vx), vy(vy) { }
-
     float vx, vy;
 };
 
-struct RGBA final : secs::Component
+// store positions and velocities field by field, so the integration loop streams plain arrays
+template <>
+struct secs::ComponentLayout<Position>
+{
+    struct Ref
+    {
+        int& x;
+        int& y;
+    };
+};
+
+template <>
+struct secs::ComponentLayout<Velocity>
+{
+    struct Ref
+    {
+        float& vx;
+        float& vy;
+    };
+};
+
+struct RGBA
 {
     RGBA(const uint8_t r, const uint8_t g, const uint8_t b) : color(r, g, b, 255) { }
 
@@ -28,12 +45,14 @@ struct RGBA final : secs::Component
 class RenderUpdateSystem final : public secs::System
 {
 public:
-    void onUpdate(float delta, secs::Scene& scene) override
+    secs::SystemAccess getAccess() const override
     {
-        for (const auto e: scene.getWith<Velocity, Position>()) {
-            auto& vel = scene.get<Velocity>(e);
-            auto& pos = scene.get<Position>(e);
+        return secs::SystemAccess{ }.write<Velocity, Position>().read<RGBA>();
+    }
 
+    void onUpdate(float delta, secs::Scene& scene) override
+    {
+        const auto integrate = [delta](secs::EntityHandle, auto vel, auto pos) {
             if (pos.x <= 0 || pos.x >= screenWidth) {
                 vel.vx = -vel.vx;
             }
@@ -44,7 +63,8 @@ public:
 
             pos.x += vel.vx * delta * 60;
             pos.y += vel.vy * delta * 60;
-        }
+        };
+        scene.parEach<Velocity, Position>(integrate);
     }
 
     void onRender(secs::Scene& scene) override
@@ -52,12 +72,9 @@ public:
         BeginDrawing();
         ClearBackground(DARKGRAY);
 
-        for (const auto e: scene.getWith<RGBA, Position>()) {
-            const auto& rgba = scene.get<RGBA>(e);
-            const auto& pos = scene.get<Position>(e);
-
+        scene.each<RGBA, Position>([](secs::EntityHandle, const RGBA& rgba, const auto pos) {
             DrawCircle(pos.x, pos.y, 3, rgba.color);
-        }
+        });
 
         const std::string fpsText = "FPS: " + std::to_string(GetFPS());
         DrawText(fpsText.c_str(), 10, 10, 28, WHITE);
@@ -73,25 +90,20 @@ int main()
     secs::Scene scene{ };
     scene.start<RenderUpdateSystem>(secs::SystemPhase::RENDER_PHASE);
 
-    for (int i = 0; i < 1000; i++) {
-        const auto e = scene.create();
-        scene.emplace<Position>(
-            e,
-            std::rand() % screenWidth,
-            std::rand() % screenHeight
-        );
-        scene.emplace<Velocity>(
-            e,
-            static_cast<float>(std::rand() % 25) + 25,
-            static_cast<float>(std::rand() % 25) + 25
-        );
-        scene.emplace<RGBA>(
-            e,
-            static_cast<uint8_t>(std::rand() % 255),
-            static_cast<uint8_t>(std::rand() % 255),
-            static_cast<uint8_t>(std::rand() % 255)
-        );
-    }
+    scene.createMany(1000, [](size_t) {
+        return secs::Bundle{
+            Position{ std::rand() % screenWidth, std::rand() % screenHeight },
+            Velocity{
+                static_cast<float>(std::rand() % 25) + 25,
+                static_cast<float>(std::rand() % 25) + 25
+            },
+            RGBA{
+                static_cast<uint8_t>(std::rand() % 255),
+                static_cast<uint8_t>(std::rand() % 255),
+                static_cast<uint8_t>(std::rand() % 255)
+            },
+        };
+    });
 
     InitWindow(screenWidth, screenHeight, "stress test");
     SetTargetFPS(0);
@@ -0,0 +1,383 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "Assert.hpp"
+#include "ChangeTicks.hpp"
+#include "ComponentInfo.hpp"
+#include "ECSProperties.hpp"
+#include "EntityManager.hpp"
+
+
+namespace secs
+{
+
+/**
+ * @brief A fixed size block of memory holding the rows of an Archetype. The memory is laid out
+ * as one column of EntityHandle's followed by one column per component type, each paired with a
+ * column of its ComponentTicks.
+ */
+struct alignas(64) Chunk
+{
+    std::byte data[CHUNK_SIZE];
+};
+
+/**
+ * @brief Stores all entities that share the exact same ComponentMask. Entities are stored as rows
+ * spread over fixed size chunks, so components of the same type are contiguous in memory.
+ */
+class Archetype
+{
+public:
+    using ComponentMask = EntityManager::ComponentMask;
+
+    /// @brief Value used in the column lookup for components not part of this archetype.
+    static constexpr size_t INVALID_COLUMN = static_cast<size_t>(-1);
+
+    Archetype(const ComponentMask& mask, const std::array<ComponentInfo, MAX_COMPONENTS>& infos)
+        : m_mask(mask)
+    {
+        m_componentToColumn.fill(INVALID_COLUMN);
+
+        size_t rowSize = sizeof(EntityHandle);
+        for (size_t i = 0; i < MAX_COMPONENTS; i++) {
+            if (!mask.test(i)) { continue; }
+            SecsAssert(infos[i], "Archetype created with unregistered component");
+            SecsAssert(infos[i].alignment <= alignof(Chunk), "Component alignment is too large");
+            if (infos[i].tag) { continue; }
+
+            m_componentToColumn[i] = m_columns.size();
+            m_columns.push_back(Column{ i, 0, 0, infos[i] });
+            rowSize += infos[i].size + sizeof(ComponentTicks);
+        }
+
+        // start with the capacity ignoring padding, then shrink until the aligned columns fit
+        m_capacity = CHUNK_SIZE / rowSize;
+        while (m_capacity > 0 && !layout(m_capacity)) { m_capacity--; }
+        SecsAssert(m_capacity > 0, "Archetype row does not fit into a single chunk");
+    }
+
+    ~Archetype()
+    {
+        clear();
+    }
+
+    Archetype(const Archetype&)            = delete;
+    Archetype& operator=(const Archetype&) = delete;
+
+    /// @brief Returns the ComponentMask all entities of this archetype share.
+    [[nodiscard]] const ComponentMask& mask() const { return m_mask; }
+
+    /// @brief Returns the amount of entities stored in this archetype.
+    [[nodiscard]] size_t size() const { return m_size; }
+
+    /// @brief Returns the amount of rows a single chunk can hold.
+    [[nodiscard]] size_t capacity() const { return m_capacity; }
+
+    /// @brief Returns the amount of allocated chunks, including empty ones kept for reuse.
+    [[nodiscard]] size_t chunkCount() const { return m_chunks.size(); }
+
+    /// @brief Returns the amount of occupied rows in the given chunk.
+    [[nodiscard]] size_t chunkSize(const size_t chunk) const
+    {
+        const size_t start = chunk * m_capacity;
+        if (start >= m_size) { return 0; }
+        return std::min(m_capacity, m_size - start);
+    }
+
+    /// @brief Checks if the component with the given bit index is part of this archetype. Tag
+    /// components are part of the mask without having a column.
+    [[nodiscard]] bool has(const size_t componentIndex) const
+    {
+        return m_mask.test(componentIndex);
+    }
+
+    /// @brief Returns all component columns of this archetype.
+    [[nodiscard]] const auto& columns() const { return m_columns; }
+
+    /// @brief Returns the EntityHandle column of the given chunk.
+    [[nodiscard]] EntityHandle* entities(const size_t chunk) const
+    {
+        return reinterpret_cast<EntityHandle*>(m_chunks[chunk]->data);
+    }
+
+    /// @brief Returns the column of component type T in the given chunk.
+    template <typename T>
+    [[nodiscard]] T* column(const size_t chunk) const
+    {
+        const Column& column = m_columns[m_componentToColumn[ComponentBitMap::getBitIndex<T>()]];
+        return reinterpret_cast<T*>(m_chunks[chunk]->data + column.offset);
+    }
+
+    /// @brief Returns the ticks column of component type T in the given chunk.
+    template <typename T>
+    [[nodiscard]] ComponentTicks* tickColumn(const size_t chunk) const
+    {
+        const Column& column = m_columns[m_componentToColumn[ComponentBitMap::getBitIndex<T>()]];
+        return reinterpret_cast<ComponentTicks*>(m_chunks[chunk]->data + column.ticksOffset);
+    }
+
+    /// @brief Returns the entity stored at the given row.
+    [[nodiscard]] EntityHandle entity(const size_t row) const
+    {
+        return entities(row / m_capacity)[row % m_capacity];
+    }
+
+    /// @brief Returns a pointer to the component with the given bit index at the given row.
+    [[nodiscard]] void* component(const size_t componentIndex, const size_t row) const
+    {
+        return component(m_columns[m_componentToColumn[componentIndex]], row);
+    }
+
+    /// @brief Returns the ticks of the component with the given bit index at the given row.
+    [[nodiscard]] ComponentTicks& ticks(const size_t componentIndex, const size_t row) const
+    {
+        return ticks(m_columns[m_componentToColumn[componentIndex]], row);
+    }
+
+    /// @brief Appends an uninitialized row for the given entity and returns its index. The caller
+    /// is responsible for constructing every component of the row.
+    size_t push(const EntityHandle entity)
+    {
+        if (m_size == m_chunks.size() * m_capacity) { m_chunks.push_back(std::make_unique<Chunk>()); }
+
+        const size_t row                             = m_size++;
+        entities(row / m_capacity)[row % m_capacity] = entity;
+        return row;
+    }
+
+    /// @brief Appends a row for each of the given entities, whose components are copies of the
+    /// components at sourceRow of source, marked as added at the given tick. Source must have every
+    /// component of this archetype. The rows are filled a chunk at a time, so each component is
+    /// copied into a contiguous run of its column.
+    void pushCopies(
+        const std::span<const EntityHandle> newEntities,
+        const Archetype& source,
+        const size_t sourceRow,
+        const Tick tick
+    )
+    {
+        reserve(m_size + newEntities.size());
+
+        size_t done = 0;
+        while (done < newEntities.size()) {
+            const size_t row   = m_size;
+            const size_t count = std::min(m_capacity - row % m_capacity, newEntities.size() - done);
+            EntityHandle* entityColumn = entities(row / m_capacity) + row % m_capacity;
+            std::ranges::copy(newEntities.subspan(done, count), entityColumn);
+
+            for (const Column& column : m_columns) {
+                SecsAssert(column.info.copy, "Attempting to copy a component that is not copyable");
+                column.info.copy(
+                    component(column, row),
+                    source.component(column.componentIndex, sourceRow),
+                    count
+                );
+                std::fill_n(&ticks(column, row), count, ComponentTicks{ tick, tick });
+            }
+
+            m_size += count;
+            done += count;
+        }
+    }
+
+    /// @brief Moves all rows of source to the back of this archetype, whose components must be a
+    /// subset of the components of source. The components this archetype does not have are
+    /// destroyed. Rows are moved in runs that are contiguous in both archetypes, and source is left
+    /// empty while keeping its chunks.
+    void takeAll(Archetype& source)
+    {
+        reserve(m_size + source.m_size);
+
+        size_t done = 0;
+        while (done < source.m_size) {
+            const size_t row         = m_size;
+            const size_t sourceSpace = source.m_capacity - done % source.m_capacity;
+            const size_t count       = std::min(
+                { m_capacity - row % m_capacity, sourceSpace, source.m_size - done }
+            );
+            std::copy_n(
+                source.entities(done / source.m_capacity) + done % source.m_capacity,
+                count,
+                entities(row / m_capacity) + row % m_capacity
+            );
+
+            for (const Column& column : source.m_columns) {
+                auto* from         = static_cast<std::byte*>(source.component(column, done));
+                const size_t index = m_componentToColumn[column.componentIndex];
+                if (index == INVALID_COLUMN) {
+                    if (!column.info.destroy) { continue; }
+                    for (size_t i = 0; i < count; i++) {
+                        column.info.destroy(from + i * column.info.size);
+                    }
+                    continue;
+                }
+
+                const Column& target = m_columns[index];
+                auto* to             = static_cast<std::byte*>(component(target, row));
+                for (size_t i = 0; i < count; i++) {
+                    column.info.relocate(to + i * column.info.size, from + i * column.info.size);
+                }
+                std::copy_n(&source.ticks(column, done), count, &ticks(target, row));
+            }
+
+            m_size += count;
+            done += count;
+        }
+        source.m_size = 0;
+    }
+
+    /// @brief Allocates enough chunks to hold the given amount of rows without allocating again.
+    void reserve(const size_t rows)
+    {
+        while (m_chunks.size() * m_capacity < rows) {
+            m_chunks.push_back(std::make_unique<Chunk>());
+        }
+    }
+
+    /// @brief Releases all chunks that hold no rows.
+    void shrinkToFit()
+    {
+        const size_t usedChunks = (m_size + m_capacity - 1) / m_capacity;
+        m_chunks.resize(usedChunks);
+        m_chunks.shrink_to_fit();
+    }
+
+    /// @brief Removes a row whose components have already been destroyed or relocated by filling
+    /// the hole with the last row. Returns the entity that was moved into the row, or an invalid
+    /// handle if no entity was moved.
+    EntityHandle swapRemove(const size_t row)
+    {
+        const size_t last = m_size - 1;
+        EntityHandle moved{ };
+
+        if (row != last) {
+            for (const Column& column : m_columns) {
+                column.info.relocate(component(column, row), component(column, last));
+                ticks(column, row) = ticks(column, last);
+            }
+            moved                                        = entity(last);
+            entities(row / m_capacity)[row % m_capacity] = moved;
+        }
+
+        // emptied chunks are kept, so reserved capacity lasts until shrinkToFit()
+        m_size--;
+        return moved;
+    }
+
+    /// @brief Destroys all components of the given row and removes it. Returns the entity that was
+    /// moved into the row, or an invalid handle if no entity was moved.
+    EntityHandle destroy(const size_t row)
+    {
+        for (const Column& column : m_columns) {
+            if (column.info.destroy) { column.info.destroy(component(column, row)); }
+        }
+        return swapRemove(row);
+    }
+
+    /// @brief Destroys all components and removes all rows, keeping the chunks for reuse.
+    void clear()
+    {
+        for (const Column& column : m_columns) {
+            if (!column.info.destroy) { continue; }
+            for (size_t row = 0; row < m_size; row++) {
+                column.info.destroy(component(column, row));
+            }
+        }
+        m_size = 0;
+    }
+
+    /// @brief Returns the cached archetype reached by adding the component with the given bit
+    /// index, or nullptr if this transition has not been taken yet.
+    [[nodiscard]] Archetype* addEdge(const size_t componentIndex) const
+    {
+        return m_addEdges[componentIndex];
+    }
+
+    /// @brief Returns the cached archetype reached by removing the component with the given bit
+    /// index, or nullptr if this transition has not been taken yet.
+    [[nodiscard]] Archetype* removeEdge(const size_t componentIndex) const
+    {
+        return m_removeEdges[componentIndex];
+    }
+
+    /// @brief Caches the transitions between this archetype and other, which differs from this
+    /// archetype only by the component with the given bit index.
+    void link(const size_t componentIndex, Archetype* other)
+    {
+        if (m_mask.test(componentIndex)) {
+            m_removeEdges[componentIndex]     = other;
+            other->m_addEdges[componentIndex] = this;
+        } else {
+            m_addEdges[componentIndex]           = other;
+            other->m_removeEdges[componentIndex] = this;
+        }
+    }
+
+private:
+    struct Column
+    {
+        /// @brief The bit index of the component stored in this column.
+        size_t componentIndex;
+        /// @brief The byte offset of this column from the start of a chunk.
+        size_t offset;
+        /// @brief The byte offset of the ticks column from the start of a chunk.
+        size_t ticksOffset;
+        ComponentInfo info;
+    };
+
+    ComponentMask m_mask{ };
+    std::vector<Column> m_columns{ };
+    /// @brief Mapping of component bit index to its column, or INVALID_COLUMN.
+    std::array<size_t, MAX_COMPONENTS> m_componentToColumn{ };
+
+    std::vector<std::unique_ptr<Chunk>> m_chunks{ };
+    /// @brief The amount of rows per chunk.
+    size_t m_capacity = 0;
+    /// @brief The amount of occupied rows over all chunks.
+    size_t m_size = 0;
+
+    std::array<Archetype*, MAX_COMPONENTS> m_addEdges{ };
+    std::array<Archetype*, MAX_COMPONENTS> m_removeEdges{ };
+
+    [[nodiscard]] void* component(const Column& column, const size_t row) const
+    {
+        const size_t chunk = row / m_capacity;
+        return m_chunks[chunk]->data + column.offset + (row % m_capacity) * column.info.size;
+    }
+
+    [[nodiscard]] ComponentTicks& ticks(const Column& column, const size_t row) const
+    {
+        std::byte* data = m_chunks[row / m_capacity]->data + column.ticksOffset;
+        return reinterpret_cast<ComponentTicks*>(data)[row % m_capacity];
+    }
+
+    /// @brief Computes the column offsets for the given capacity. Returns false if the columns do
+    /// not fit into a chunk.
+    bool layout(const size_t capacity)
+    {
+        size_t offset = sizeof(EntityHandle) * capacity;
+        for (Column& column : m_columns) {
+            offset        = alignUp(offset, column.info.alignment);
+            column.offset = offset;
+            offset += column.info.size * capacity;
+
+            offset             = alignUp(offset, alignof(ComponentTicks));
+            column.ticksOffset = offset;
+            offset += sizeof(ComponentTicks) * capacity;
+        }
+        return offset <= CHUNK_SIZE;
+    }
+
+    static size_t alignUp(const size_t offset, const size_t alignment)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+};
+
+} // namespace secs
@@ -0,0 +1,602 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <span>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Archetype.hpp"
+#include "Bundle.hpp"
+#include "ComponentBitMap.hpp"
+#include "ComponentLayout.hpp"
+#include "EntityManager.hpp"
+#include "JobSystem.hpp"
+#include "Query.hpp"
+
+
+namespace secs
+{
+
+/**
+ * @brief The archetype based alternative to the ComponentManager. Entities that share the same
+ * ComponentMask are stored together in an Archetype, and adding or removing a component moves the
+ * entity to the archetype of its new mask along a cached transition edge.
+ */
+class ArchetypeManager
+{
+public:
+    using ComponentMask = EntityManager::ComponentMask;
+
+    ArchetypeManager()
+    {
+        m_root = getCreateArchetype(ComponentMask{ });
+    }
+
+    /// @brief Should be called each time an entity is created. Places the entity into the empty
+    /// archetype.
+    void create(const EntityHandle entity)
+    {
+        if (entity.index() >= m_locations.size()) { m_locations.resize(entity.index() + 1); }
+        m_locations[entity.index()] = EntityLocation{ m_root, m_root->push(entity) };
+    }
+
+    /// @brief Should be called each time an entity is destroyed. Destroys all components of this
+    /// entity.
+    void destroy(const EntityHandle entity)
+    {
+        EntityLocation* location = find(entity);
+        if (!location) { return; }
+
+        const auto [archetype, row] = *location;
+        *location                   = EntityLocation{ };
+        updateMoved(archetype->destroy(row), row);
+    }
+
+    /// @brief Destroys all entities of the archetypes matching the query, clearing each archetype
+    /// as a whole. The destroyed entities are appended to destroyed.
+    void destroyWith(const QueryMask& query, std::vector<EntityHandle>& destroyed)
+    {
+        for (Archetype* archetype : m_archetypeList) {
+            if (!query.matches(archetype->mask())) { continue; }
+
+            for (size_t chunk = 0; chunk < archetype->chunkCount(); chunk++) {
+                const EntityHandle* entities = archetype->entities(chunk);
+                for (size_t row = 0; row < archetype->chunkSize(chunk); row++) {
+                    m_locations[entities[row].index()] = EntityLocation{ };
+                    destroyed.push_back(entities[row]);
+                }
+            }
+            archetype->clear();
+        }
+    }
+
+    /// @brief Destroys all entities, clearing every archetype as a whole.
+    void destroyAll()
+    {
+        for (Archetype* archetype : m_archetypeList) { archetype->clear(); }
+        std::ranges::fill(m_locations, EntityLocation{ });
+    }
+
+    /// @brief Removes the components of type T from all entities, moving all rows of each archetype
+    /// with T to its neighbour without T at once. The affected entities are appended to cleared.
+    template <typename T>
+        requires(Component<T>)
+    void clear(std::vector<EntityHandle>& cleared)
+    {
+        const size_t componentIndex = ComponentBitMap::getBitIndex<T>();
+
+        // the archetype list may grow while moving, so iterate by index
+        for (size_t i = 0; i < m_archetypeList.size(); i++) {
+            Archetype* source = m_archetypeList[i];
+            if (!source->has(componentIndex) || source->size() == 0) { continue; }
+
+            Archetype* target = source->removeEdge(componentIndex);
+            if (!target) {
+                target = getCreateArchetype(ComponentMask{ source->mask() }.reset(componentIndex));
+                source->link(componentIndex, target);
+            }
+
+            const size_t first = target->size();
+            target->takeAll(*source);
+            for (size_t row = first; row < target->size(); row++) {
+                const EntityHandle entity   = target->entity(row);
+                m_locations[entity.index()] = EntityLocation{ target, row };
+                cleared.push_back(entity);
+            }
+        }
+    }
+
+    /// @brief Create Component of type T and assign it to the provided entity, marking it as added
+    /// at the given tick. If the entity already has a component of this type, do nothing.
+    template <typename T, typename... Args>
+        requires(Component<T>)
+    ComponentRef<T> emplace(const EntityHandle entity, const Tick tick, Args&&... args)
+    {
+        const size_t componentIndex = ComponentBitMap::getBitIndex<T>();
+        EntityLocation* location    = find(entity);
+        SecsAssert(location, "Attempting to register a component to a non existing entity");
+        Archetype* source = location->archetype;
+
+        if (source->has(componentIndex)) { return componentAt<T>(*source, location->row); }
+
+        registerComponent<T>();
+
+        Archetype* target = source->addEdge(componentIndex);
+        if (!target) {
+            target = getCreateArchetype(ComponentMask{ source->mask() }.set(componentIndex));
+            source->link(componentIndex, target);
+        }
+
+        // construct the new component first, so args may still reference the entities components
+        const size_t row = target->push(entity);
+        if constexpr (!TagComponent<T>) {
+            new(target->component(componentIndex, row)) T(std::forward<Args>(args)...);
+            target->ticks(componentIndex, row) = ComponentTicks{ tick, tick };
+        }
+
+        move(*location, target, row);
+        return componentAt<T>(*target, row);
+    }
+
+    /// @brief Moves the components of the bundle to the entity with a single move to the target
+    /// archetype. Types the entity already has are skipped.
+    template <typename... Ts>
+    void emplace(const EntityHandle entity, const Tick tick, Bundle<Ts...>&& bundle)
+    {
+        EntityLocation* location = find(entity);
+        SecsAssert(location, "Attempting to register a component to a non existing entity");
+        Archetype* source = location->archetype;
+
+        const ComponentMask mask = source->mask() | Bundle<Ts...>::mask();
+        if (mask == source->mask()) { return; }
+
+        (registerComponent<Ts>(), ...);
+        Archetype* target = getCreateArchetype(mask);
+        const size_t row  = target->push(entity);
+        (constructMissing<Ts>(*source, *target, row, tick, std::get<Ts>(bundle.components)), ...);
+
+        move(*location, target, row);
+    }
+
+    /// @brief Should be called instead of create() for entities created in bulk. Places the i-th
+    /// entity directly into the archetype of the bundle makeBundle(i) returns.
+    template <typename... Ts, typename Fn>
+    void createMany(const std::span<const EntityHandle> entities, const Tick tick, Fn& makeBundle)
+    {
+        (registerComponent<Ts>(), ...);
+        Archetype* target = getCreateArchetype(Bundle<Ts...>::mask());
+        target->reserve(target->size() + entities.size());
+
+        for (size_t i = 0; i < entities.size(); i++) {
+            const EntityHandle entity = entities[i];
+            if (entity.index() >= m_locations.size()) { m_locations.resize(entity.index() + 1); }
+
+            const size_t row            = target->push(entity);
+            m_locations[entity.index()] = EntityLocation{ target, row };
+            Bundle<Ts...> bundle        = makeBundle(i);
+            (construct<Ts>(*target, row, tick, std::get<Ts>(bundle.components)), ...);
+        }
+    }
+
+    /// @brief Should be called instead of create() for entities created as copies of source. Places
+    /// the entities into the archetype of mask, which must be a subset of the mask of source, as
+    /// contiguous rows holding copies of the components of source.
+    void instantiate(
+        const EntityHandle source,
+        const ComponentMask& mask,
+        const std::span<const EntityHandle> entities,
+        const Tick tick
+    )
+    {
+        const EntityLocation* location = find(source);
+        SecsAssert(location, "Attempting to instantiate a non existing entity");
+
+        Archetype* target = getCreateArchetype(mask);
+        const size_t row  = target->size();
+        target->pushCopies(entities, *location->archetype, location->row, tick);
+
+        for (size_t i = 0; i < entities.size(); i++) {
+            const EntityHandle entity = entities[i];
+            if (entity.index() >= m_locations.size()) { m_locations.resize(entity.index() + 1); }
+            m_locations[entity.index()] = EntityLocation{ target, row + i };
+        }
+    }
+
+    /// @brief Stores the ComponentInfo of all given types up front.
+    template <typename... Ts>
+    void registerComponents()
+    {
+        (registerComponent<Ts>(), ...);
+    }
+
+    /// @brief Reserves room for the given amount of entities in the location table.
+    void reserve(const size_t entityCount)
+    {
+        m_locations.reserve(entityCount);
+    }
+
+    /// @brief Reserves chunks for count entities in the archetype holding exactly the components
+    /// Ts, creating the archetype if needed.
+    template <typename... Ts>
+    void reserve(const size_t count)
+    {
+        (registerComponent<Ts>(), ...);
+        ComponentMask mask{ };
+        (mask.set(ComponentBitMap::getBitIndex<Ts>()), ...);
+        getCreateArchetype(mask)->reserve(count);
+    }
+
+    /// @brief Releases the unused chunks of all archetypes and the unused capacity of the location
+    /// table.
+    void shrinkToFit()
+    {
+        for (Archetype* archetype : m_archetypeList) { archetype->shrinkToFit(); }
+        m_locations.shrink_to_fit();
+    }
+
+    /// @brief Removes the Component of type T from entity. If entity does not have a component of
+    /// type T, do nothing.
+    template <typename T>
+        requires(Component<T>)
+    void remove(const EntityHandle entity)
+    {
+        EntityLocation* location = find(entity);
+        if (!location) { return; }
+
+        const size_t componentIndex = ComponentBitMap::getBitIndex<T>();
+        Archetype* source           = location->archetype;
+
+        if (!source->has(componentIndex)) { return; }
+
+        Archetype* target = source->removeEdge(componentIndex);
+        if (!target) {
+            target = getCreateArchetype(ComponentMask{ source->mask() }.reset(componentIndex));
+            source->link(componentIndex, target);
+        }
+
+        move(*location, target, target->push(entity));
+    }
+
+    /// @brief An unsafe get of the component of type T associated with the given entity
+    template <typename T>
+        requires(Component<T>)
+    ComponentRef<T> get(const EntityHandle entity) const
+    {
+        const EntityLocation* location = find(entity);
+        const size_t componentIndex    = ComponentBitMap::getBitIndex<T>();
+        SecsAssert(
+            location && location->archetype->has(componentIndex),
+            "Failed to get Component from Archetype"
+        );
+        return componentAt<T>(*location->archetype, location->row);
+    }
+
+    /// @brief A safe get of the component of type T associated with the given entity
+    template <typename T>
+        requires(Component<T>)
+    ComponentPtr<T> getSafe(const EntityHandle entity) const
+    {
+        const EntityLocation* location = find(entity);
+        if (!location) { return nullptr; }
+
+        const auto [archetype, row] = *location;
+        const size_t componentIndex = ComponentBitMap::getBitIndex<T>();
+        if (!archetype->has(componentIndex)) { return nullptr; }
+        return makePointer(static_cast<T*>(archetype->component(componentIndex, row)));
+    }
+
+    /// @brief Marks the component of type T of the entity as changed at the given tick.
+    template <typename T>
+        requires(Component<T>)
+    void markChanged(const EntityHandle entity, const Tick tick)
+    {
+        const EntityLocation* location = find(entity);
+        const size_t componentIndex    = ComponentBitMap::getBitIndex<T>();
+        if (!location || !location->archetype->has(componentIndex)) { return; }
+        location->archetype->ticks(componentIndex, location->row).changed = tick;
+    }
+
+    /// @brief Returns the change ticks of the component of type T of the entity, or nullptr.
+    template <typename T>
+        requires(Component<T>)
+    const ComponentTicks* getTicks(const EntityHandle entity) const
+    {
+        const EntityLocation* location = find(entity);
+        const size_t componentIndex    = ComponentBitMap::getBitIndex<T>();
+        if (!location || !location->archetype->has(componentIndex)) { return nullptr; }
+        return &location->archetype->ticks(componentIndex, location->row);
+    }
+
+    /// @brief Checks if the entity has this component type.
+    template <typename T>
+        requires(Component<T>)
+    bool hasComponent(const EntityHandle entity) const
+    {
+        const EntityLocation* location = find(entity);
+        return location && location->archetype->has(ComponentBitMap::getBitIndex<T>());
+    }
+
+    /// @brief Appends all entities matching the query to entities. Only the entity columns of
+    /// matching archetypes are visited.
+    void getWith(const QueryMask& query, std::vector<EntityHandle>& entities) const
+    {
+        for (const Archetype* archetype : m_archetypeList) {
+            if (!query.matches(archetype->mask())) { continue; }
+
+            for (size_t chunk = 0; chunk < archetype->chunkCount(); chunk++) {
+                const EntityHandle* column = archetype->entities(chunk);
+                entities.insert(entities.end(), column, column + archetype->chunkSize(chunk));
+            }
+        }
+    }
+
+    /// @brief Calls fn(EntityHandle, ...) for every entity matching the query terms, passing T& for
+    /// each required component and T* for each Optional<T>. The query is only tested once per
+    /// archetype, after which the matching archetypes are visited chunk by chunk, streaming their
+    /// columns. Added<T> and Changed<T> terms compare the component ticks against since. Adding or
+    /// removing components or entities inside fn is not allowed.
+    template <typename... Terms, typename Fn>
+    void each(const Tick since, Fn&& fn) const
+    {
+        const QueryMask query = makeQueryMask<Terms...>();
+
+        for (const Archetype* archetype : m_archetypeList) {
+            if (!query.matches(archetype->mask())) { continue; }
+
+            for (size_t chunk = 0; chunk < archetype->chunkCount(); chunk++) {
+                eachInChunk<Terms...>(
+                    fn,
+                    since,
+                    0,
+                    archetype->chunkSize(chunk),
+                    archetype->entities(chunk),
+                    std::make_tuple(queryColumn<Terms>(*archetype, chunk)...),
+                    std::index_sequence_for<Terms...>{ }
+                );
+            }
+        }
+    }
+
+    /// @brief Same as each(), but splits the chunks of the matching archetypes into ranges of at
+    /// most grain rows which are processed as jobs, so fn may be called concurrently.
+    template <typename... Terms, typename Fn>
+    void parEach(const Tick since, JobSystem& jobs, const size_t grain, Fn&& fn) const
+    {
+        const QueryMask query = makeQueryMask<Terms...>();
+
+        std::vector<ChunkRange> ranges{ };
+        for (const Archetype* archetype : m_archetypeList) {
+            if (!query.matches(archetype->mask())) { continue; }
+
+            for (size_t chunk = 0; chunk < archetype->chunkCount(); chunk++) {
+                const size_t size = archetype->chunkSize(chunk);
+                for (size_t begin = 0; begin < size; begin += grain) {
+                    const size_t end = std::min(begin + grain, size);
+                    ranges.push_back(ChunkRange{ archetype, chunk, begin, end });
+                }
+            }
+        }
+
+        jobs.run(ranges.size(), [&](const size_t i) {
+            const auto& [archetype, chunk, begin, end] = ranges[i];
+            eachInChunk<Terms...>(
+                fn,
+                since,
+                begin,
+                end,
+                archetype->entities(chunk),
+                std::make_tuple(queryColumn<Terms>(*archetype, chunk)...),
+                std::index_sequence_for<Terms...>{ }
+            );
+        });
+    }
+
+private:
+    /// @brief The location of a single entity inside the archetype storage.
+    struct EntityLocation
+    {
+        Archetype* archetype = nullptr;
+        size_t row           = 0;
+    };
+
+    /// @brief All archetypes by their ComponentMask.
+    std::unordered_map<ComponentMask, std::unique_ptr<Archetype>> m_archetypes{ };
+    /// @brief All archetypes in creation order, used for iteration.
+    std::vector<Archetype*> m_archetypeList{ };
+    /// @brief The archetype without any components. All entities start out here.
+    Archetype* m_root = nullptr;
+    /// @brief The archetype and row of each entity, indexed by entity index.
+    std::vector<EntityLocation> m_locations{ };
+    /// @brief Type erased info of each registered component, indexed by bit index.
+    std::array<ComponentInfo, MAX_COMPONENTS> m_componentInfos{ };
+
+    /// @brief Returns the location of the entity, or nullptr if the entity is not stored or the
+    /// handle is stale.
+    EntityLocation* find(const EntityHandle entity)
+    {
+        if (entity.index() >= m_locations.size()) { return nullptr; }
+
+        EntityLocation& location = m_locations[entity.index()];
+        if (!location.archetype || location.archetype->entity(location.row) != entity) {
+            return nullptr;
+        }
+        return &location;
+    }
+
+    const EntityLocation* find(const EntityHandle entity) const
+    {
+        return const_cast<ArchetypeManager*>(this)->find(entity);
+    }
+
+    /// @brief Stores the ComponentInfo of T, which archetypes need to lay out their columns.
+    template <typename T>
+    void registerComponent()
+    {
+        const size_t componentIndex = ComponentBitMap::getBitIndex<T>();
+        if (!m_componentInfos[componentIndex]) {
+            m_componentInfos[componentIndex] = ComponentInfo::of<T>();
+        }
+    }
+
+    /// @brief Returns the component of type T in the given row of an archetype having T.
+    template <typename T>
+    static ComponentRef<T> componentAt(const Archetype& archetype, const size_t row)
+    {
+        if constexpr (TagComponent<T>) {
+            return tagInstance<T>();
+        } else {
+            const size_t componentIndex = ComponentBitMap::getBitIndex<T>();
+            return makeRef(*static_cast<T*>(archetype.component(componentIndex, row)));
+        }
+    }
+
+    /// @brief Move constructs the component into the uninitialized row of the archetype and marks
+    /// it as added. Tags have no column, so nothing is constructed for them.
+    template <typename T>
+    static void construct(Archetype& archetype, const size_t row, const Tick tick, T& component)
+    {
+        if constexpr (!TagComponent<T>) {
+            const size_t componentIndex = ComponentBitMap::getBitIndex<T>();
+            new(archetype.component(componentIndex, row)) T(std::move(component));
+            archetype.ticks(componentIndex, row) = ComponentTicks{ tick, tick };
+        }
+    }
+
+    /// @brief Same as construct(), but only if the source archetype does not already have T, in
+    /// which case move() relocates the existing component.
+    template <typename T>
+    static void constructMissing(
+        const Archetype& source,
+        Archetype& target,
+        const size_t row,
+        const Tick tick,
+        T& component
+    )
+    {
+        if (source.has(ComponentBitMap::getBitIndex<T>())) { return; }
+        construct(target, row, tick, component);
+    }
+
+    /// @brief Returns the archetype with the given mask, creating it if it does not exist yet.
+    Archetype* getCreateArchetype(const ComponentMask& mask)
+    {
+        auto& archetype = m_archetypes[mask];
+        if (!archetype) {
+            archetype = std::make_unique<Archetype>(mask, m_componentInfos);
+            m_archetypeList.push_back(archetype.get());
+        }
+        return archetype.get();
+    }
+
+    /// @brief Moves the components of the entity at location into the already pushed row of
+    /// target. Components the target does not have are destroyed.
+    void move(EntityLocation& location, Archetype* target, const size_t targetRow)
+    {
+        Archetype* source      = location.archetype;
+        const size_t sourceRow = location.row;
+
+        for (const auto& column : source->columns()) {
+            void* component = source->component(column.componentIndex, sourceRow);
+            if (target->has(column.componentIndex)) {
+                column.info.relocate(target->component(column.componentIndex, targetRow), component);
+                target->ticks(column.componentIndex, targetRow) =
+                    source->ticks(column.componentIndex, sourceRow);
+            } else if (column.info.destroy) {
+                column.info.destroy(component);
+            }
+        }
+
+        location = EntityLocation{ target, targetRow };
+        updateMoved(source->swapRemove(sourceRow), sourceRow);
+    }
+
+    /// @brief A range of rows of a single chunk, the unit of work of parEach().
+    struct ChunkRange
+    {
+        const Archetype* archetype;
+        size_t chunk;
+        size_t begin;
+        size_t end;
+    };
+
+    /// @brief Updates the location of an entity that was moved into row by a swap remove.
+    void updateMoved(const EntityHandle moved, const size_t row)
+    {
+        if (moved) { m_locations[moved.index()].row = row; }
+    }
+
+    template <typename... Terms, typename Fn, typename Columns, size_t... I>
+    static void eachInChunk(
+        Fn& fn,
+        const Tick since,
+        const size_t begin,
+        const size_t end,
+        const EntityHandle* entities,
+        const Columns& columns,
+        std::index_sequence<I...>
+    )
+    {
+        for (size_t i = begin; i < end; i++) {
+            if (!(passes<Terms>(std::get<I>(columns), i, since) && ...)) { continue; }
+
+            std::apply(
+                fn,
+                std::tuple_cat(std::make_tuple(entities[i]), fetch<Terms>(std::get<I>(columns), i)...)
+            );
+        }
+    }
+
+    /// @brief Returns the column a query term reads from in the given chunk, or nullptr if the term
+    /// has no column in this archetype. Tick terms read from the ticks column, and tags from their
+    /// single instance.
+    template <typename Term>
+    static auto queryColumn(const Archetype& archetype, const size_t chunk)
+    {
+        using T = typename QueryTerm<Term>::Type;
+        if constexpr (isTickTerm<Term>()) {
+            return archetype.tickColumn<T>(chunk);
+        } else if constexpr (TagComponent<T> && isFetchedTerm<Term>()) {
+            return archetype.has(ComponentBitMap::getBitIndex<T>()) ? &tagInstance<T>() : nullptr;
+        } else if constexpr (QueryTerm<Term>::KIND == REQUIRED_TERM) {
+            return archetype.column<T>(chunk);
+        } else if constexpr (QueryTerm<Term>::KIND == OPTIONAL_TERM) {
+            if (!archetype.has(ComponentBitMap::getBitIndex<T>())) { return static_cast<T*>(nullptr); }
+            return archetype.column<T>(chunk);
+        } else {
+            return nullptr;
+        }
+    }
+
+    /// @brief Checks if the given row of a chunk passes the tick filter of a query term. Terms
+    /// without a tick filter always pass.
+    template <typename Term, typename Column>
+    static bool passes(Column column, const size_t row, const Tick since)
+    {
+        if constexpr (isTickTerm<Term>()) {
+            return QueryTerm<Term>::passes(column[row], since);
+        } else {
+            return true;
+        }
+    }
+
+    /// @brief Returns the arguments a query term hands out for the given row of a chunk.
+    template <typename Term, typename Column>
+    static auto fetch(Column column, const size_t row)
+    {
+        using T = typename QueryTerm<Term>::Type;
+        // all rows share the single instance of a tag
+        const size_t index = TagComponent<T> ? 0 : row;
+        if constexpr (QueryTerm<Term>::KIND == REQUIRED_TERM) {
+            return std::tuple<ComponentRef<T>>{ makeRef(column[index]) };
+        } else if constexpr (QueryTerm<Term>::KIND == OPTIONAL_TERM) {
+            return std::make_tuple(makePointer(column ? column + index : nullptr));
+        } else {
+            return std::tuple<>{ };
+        }
+    }
+};
+
+} // namespace secs
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "Component.hpp"
+#include "ComponentBitMap.hpp"
+#include "ComponentMask.hpp"
+
+
+namespace secs
+{
+
+/**
+ * @brief A set of components of different types that is added to an entity in a single structural
+ * change, instead of moving the entity once per component.
+ *
+ * @code
+ * scene.emplace(entity, Bundle{ Position{ 0, 0 }, Velocity{ 1, 1 } });
+ * @endcode
+ */
+template <typename... Ts>
+    requires(sizeof...(Ts) > 0 && (Component<Ts> && ...))
+struct Bundle
+{
+    std::tuple<Ts...> components;
+
+    explicit Bundle(Ts... components) : components(std::move(components)...) { }
+
+    /// @brief Returns the ComponentMask of all component types of this bundle.
+    static ComponentMask mask()
+    {
+        ComponentMask mask{ };
+        (mask.set(ComponentBitMap::getBitIndex<Ts>()), ...);
+        return mask;
+    }
+};
+
+template <typename... Ts>
+Bundle(Ts...) -> Bundle<Ts...>;
+
+/// @brief Checks if T is a Bundle.
+template <typename T>
+constexpr bool isBundle = false;
+
+template <typename... Ts>
+constexpr bool isBundle<Bundle<Ts...>> = true;
+
+} // namespace secs
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "ECSProperties.hpp"
+#include "EntityHandle.hpp"
+
+
+namespace secs
+{
+
+/// @brief A point in time of a Scene. The tick advances every time a system runs, and component
+/// changes are stamped with the tick they happened at. 64 bits so it never wraps in practice.
+using Tick = uint64_t;
+
+/// @brief The ticks a single component was added and last changed at.
+struct ComponentTicks
+{
+    Tick added   = 0;
+    Tick changed = 0;
+
+    /// @brief Checks if the component was added after the given tick.
+    [[nodiscard]] bool isAdded(const Tick since) const { return added > since; }
+
+    /// @brief Checks if the component was added or changed after the given tick.
+    [[nodiscard]] bool isChanged(const Tick since) const { return changed > since; }
+};
+
+/// @brief The change tick state of a Scene.
+struct SceneTicks
+{
+    /// @brief The tick all changes are currently stamped with.
+    Tick current = 1;
+    /// @brief The tick the system running on this thread last ran at. Added<T> and Changed<T>
+    /// filters compare against this. Is 0 outside of systems, so everything counts as changed.
+    /// Thread local, as systems that do not conflict run concurrently.
+    static inline thread_local Tick lastRun = 0;
+};
+
+/**
+ * @brief Records which components have been removed from which entities, so systems can react to
+ * removals that happened since they last ran.
+ *
+ * Owned by the Scene, which only records removals while systems are registered, prunes the entries
+ * every system has seen on each onUpdate() and onRender(), and clears the log once the last system
+ * stops. Its size is thereby bounded by the removals since the oldest last run of any system.
+ */
+class RemovedComponentLog
+{
+public:
+    /// @brief Records that the component with the given bit index was removed from the entity.
+    void record(const size_t componentIndex, const EntityHandle entity, const Tick tick)
+    {
+        m_removed[componentIndex].push_back(Entry{ entity, tick });
+    }
+
+    /// @brief Records that the component with the given bit index was removed from all entities.
+    void recordMany(
+        const size_t componentIndex,
+        const std::span<const EntityHandle> entities,
+        const Tick tick
+    )
+    {
+        std::vector<Entry>& entries = m_removed[componentIndex];
+        entries.reserve(entries.size() + entities.size());
+        for (const EntityHandle entity : entities) { entries.push_back(Entry{ entity, tick }); }
+    }
+
+    /// @brief Returns all entities the component with the given bit index was removed from after
+    /// the given tick.
+    [[nodiscard]] std::vector<EntityHandle> getSince(
+        const size_t componentIndex,
+        const Tick since
+    ) const
+    {
+        std::vector<EntityHandle> entities{ };
+        for (const auto& [entity, tick] : m_removed[componentIndex]) {
+            if (tick > since) { entities.push_back(entity); }
+        }
+        return entities;
+    }
+
+    /// @brief Drops all entries that happened at or before the given tick. Entries are recorded in
+    /// tick order, so only a prefix of each log is dropped.
+    void prune(const Tick until)
+    {
+        for (auto& entries : m_removed) {
+            size_t count = 0;
+            while (count < entries.size() && entries[count].tick <= until) { count++; }
+            entries.erase(entries.begin(), entries.begin() + static_cast<std::ptrdiff_t>(count));
+        }
+    }
+
+    /// @brief Drops all entries.
+    void clear()
+    {
+        for (auto& entries : m_removed) { entries.clear(); }
+    }
+
+private:
+    struct Entry
+    {
+        EntityHandle entity;
+        Tick tick;
+    };
+
+    /// @brief The removal log of each component type, indexed by bit index.
+    std::array<std::vector<Entry>, MAX_COMPONENTS> m_removed{ };
+};
+
+} // namespace secs
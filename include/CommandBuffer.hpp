@@ -0,0 +1,203 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "Component.hpp"
+#include "ComponentBitMap.hpp"
+#include "EntityHandle.hpp"
+
+
+namespace secs
+{
+
+class Scene;
+
+/**
+ * @brief Records structural changes, i.e. creating and destroying entities and adding and removing
+ * components, so they can be applied to a Scene later on. This allows systems to make structural
+ * changes while iterating, and systems running concurrently to do so without synchronization, as
+ * every thread records into its own buffer.
+ *
+ * @note On playback, commands are applied grouped by component type rather than in the order they
+ * were recorded: first all entities are created, then components are emplaced and removed one
+ * component type after the other, and finally entities are destroyed. Only commands that commute
+ * are reordered. The emplaces and removes of a component type keep their recorded order, so
+ * removing and then emplacing a component replaces it, and destroying an entity ends all of its
+ * commands anyway.
+ */
+class CommandBuffer
+{
+public:
+    CommandBuffer() = default;
+
+    ~CommandBuffer()
+    {
+        clear();
+    }
+
+    CommandBuffer(const CommandBuffer&)            = delete;
+    CommandBuffer& operator=(const CommandBuffer&) = delete;
+    CommandBuffer(CommandBuffer&&)                 = default;
+    CommandBuffer& operator=(CommandBuffer&&)      = delete;
+
+    /// @brief Records the creation of an entity. The returned handle is only a placeholder which
+    /// can be passed to the other commands of this buffer, and is replaced with the real entity on
+    /// playback.
+    EntityHandle create()
+    {
+        return EntityHandle{ static_cast<EntityIndex>(++m_createCount), PENDING_GENERATION };
+    }
+
+    /// @brief Records the destruction of the given entity.
+    void destroy(const EntityHandle entity)
+    {
+        m_destroyed.push_back(entity);
+    }
+
+    /// @brief Records adding a component of type T to the given entity. The component is
+    /// constructed right away and moved into the scene on playback. If the entity already has a
+    /// component of this type by then, nothing is changed.
+    template <typename T, typename... Args>
+        requires(Component<T>)
+    void emplace(const EntityHandle entity, Args&&... args)
+    {
+        void* component = allocate(sizeof(T), alignof(T));
+        new(component) T(std::forward<Args>(args)...);
+        m_components.push_back(
+            ComponentCommand{
+                entity,
+                ComponentBitMap::getBitIndex<T>(),
+                component,
+                &applyEmplace<T>,
+                [](void* ptr) { static_cast<T*>(ptr)->~T(); },
+            }
+        );
+    }
+
+    /// @brief Records removing the component of type T from the given entity.
+    template <typename T>
+        requires(Component<T>)
+    void remove(const EntityHandle entity)
+    {
+        m_components.push_back(
+            ComponentCommand{
+                entity,
+                ComponentBitMap::getBitIndex<T>(),
+                nullptr,
+                &applyRemove<T>,
+                nullptr,
+            }
+        );
+    }
+
+    /// @brief Checks if no commands have been recorded.
+    [[nodiscard]] bool empty() const
+    {
+        return m_createCount == 0 && m_destroyed.empty() && m_components.empty();
+    }
+
+    /// @brief Applies all recorded commands to the scene and clears the buffer. Commands on
+    /// entities that are no longer alive by then are skipped.
+    void playback(Scene& scene);
+
+    /// @brief Discards all recorded commands. Keeps the allocated memory for reuse.
+    void clear()
+    {
+        for (const ComponentCommand& command : m_components) {
+            if (command.component) { command.destroy(command.component); }
+        }
+        m_components.clear();
+        m_destroyed.clear();
+        m_created.clear();
+        m_createCount = 0;
+        m_blockIndex  = 0;
+        m_blockOffset = 0;
+    }
+
+    /// @brief Releases the memory blocks and capacity not needed by the recorded commands.
+    void shrinkToFit()
+    {
+        const bool hasComponents = m_blockIndex > 0 || m_blockOffset > 0;
+        m_blocks.resize(hasComponents ? m_blockIndex + 1 : 0);
+        m_blocks.shrink_to_fit();
+        m_created.shrink_to_fit();
+        m_destroyed.shrink_to_fit();
+        m_components.shrink_to_fit();
+    }
+
+private:
+    /// @brief Placeholder entities of this buffer carry this generation, which is never valid.
+    static constexpr EntityGeneration PENDING_GENERATION = 0;
+    /// @brief The size of the blocks recorded components are constructed in.
+    static constexpr size_t BLOCK_SIZE = 16 * 1024;
+
+    /// @brief Emplaces or removes a component of a single type.
+    struct ComponentCommand
+    {
+        EntityHandle entity;
+        size_t componentIndex;
+        /// @brief The recorded component to emplace, or nullptr for a removal.
+        void* component;
+        /// @brief Moves the component into the scene, or removes it from the entity.
+        void (*apply)(Scene& scene, EntityHandle entity, void* component);
+        void (*destroy)(void* component);
+    };
+
+    size_t m_createCount = 0;
+    /// @brief The real entities of the placeholders, filled on playback.
+    std::vector<EntityHandle> m_created{ };
+    std::vector<EntityHandle> m_destroyed{ };
+    /// @brief The emplaces and removes, in the order they were recorded.
+    std::vector<ComponentCommand> m_components{ };
+
+    /// @brief Memory blocks the recorded components live in, reused after each playback.
+    std::vector<std::unique_ptr<std::byte[]>> m_blocks{ };
+    size_t m_blockIndex  = 0;
+    size_t m_blockOffset = 0;
+
+    /// @brief Returns uninitialized memory for a recorded component from the current block.
+    void* allocate(const size_t size, const size_t alignment)
+    {
+        SecsAssert(size + alignment <= BLOCK_SIZE, "Component is too large for a CommandBuffer");
+
+        while (true) {
+            if (m_blockIndex == m_blocks.size()) {
+                m_blocks.push_back(std::make_unique<std::byte[]>(BLOCK_SIZE));
+            }
+
+            std::byte* block     = m_blocks[m_blockIndex].get();
+            const auto address   = reinterpret_cast<uintptr_t>(block + m_blockOffset);
+            const size_t padding = (alignment - address % alignment) % alignment;
+            if (m_blockOffset + padding + size <= BLOCK_SIZE) {
+                void* memory = block + m_blockOffset + padding;
+                m_blockOffset += padding + size;
+                return memory;
+            }
+
+            m_blockIndex++;
+            m_blockOffset = 0;
+        }
+    }
+
+    /// @brief Returns the real entity of a placeholder, or the entity itself.
+    [[nodiscard]] EntityHandle resolve(const EntityHandle entity) const
+    {
+        if (!entity || entity.generation() != PENDING_GENERATION) { return entity; }
+        SecsAssert(entity.index() <= m_created.size(), "Placeholder of another CommandBuffer");
+        return m_created[entity.index() - 1];
+    }
+
+    template <typename T>
+    static void applyEmplace(Scene& scene, EntityHandle entity, void* component);
+
+    template <typename T>
+    static void applyRemove(Scene& scene, EntityHandle entity, void* component);
+};
+
+} // namespace secs
@@ -1,41 +1,54 @@
 #pragma once
 
-#include <chrono>
+#include <concepts>
+#include <type_traits>
 
 namespace secs
 {
 
+/**
+ * @brief Any plain struct can be used as a component, no base class is required. Storages move
+ * components around when entities change archetype or get swap removed, so components must be
+ * movable, i.e. move constructible and move assignable non const object types. Components are
+ * type erased through their bit index and ComponentInfo, so they carry no per instance overhead.
+ */
+template <typename T>
+concept Component = std::movable<T> && std::same_as<T, std::remove_cv_t<T>>;
 
-// todo: we dont actually need a base Component struct, we can use type erasure (which we do
-//  anyway using std::type_index), to allow any structs to become Components
-
-/// @brief Unique Handle for components. Is not randomly assigned, but sequentially. 0 is an invalid
-/// handle.
-using ComponentHandle                       = uint32_t;
-constexpr ComponentHandle INVALID_COMPONENT = 0;
-
-// ReSharper disable once CppClassCanBeFinal
 /**
- * @brief The base Component abstract class that all other Components must implement.
+ * @brief Empty components, such as markers like Selected or Enemy, are tags. They carry no state,
+ * so they are stored purely as their bit in the ComponentMask: adding or removing one only flips
+ * the bit, and no list, column or change ticks exist for them. Every reference handed out for a
+ * tag refers to the same instance returned by tagInstance().
  */
-struct Component
-{
-    Component() : handle(++currentComponentHandle) { }
+template <typename T>
+concept TagComponent = Component<T> && std::is_empty_v<T>;
 
-    [[nodiscard]] ComponentHandle getComponentHandle() const
-    {
-        return handle;
-    }
+/// @brief Returns the instance standing in for every component of the tag type T.
+template <typename T>
+    requires(TagComponent<T>)
+T& tagInstance()
+{
+    static T s_instance{ };
+    return s_instance;
+}
 
-    virtual ~Component()                       = default;
-    Component(Component&)                      = delete; // no copying please
-    Component operator=(const Component&)      = delete;
-    Component(Component&&) noexcept            = default;
-    Component& operator=(Component&&) noexcept = default;
+/**
+ * @brief Marks component types whose objects can be moved to another address by copying their
+ * bytes, without running the move constructor and destructor. Storages relocate such components
+ * with memcpy and grow their buffers with bulk copies. True for trivially copyable types, and can
+ * be specialized for other types that do not refer to their own address, e.g. ones holding a
+ * std::unique_ptr:
+ *
+ * @code
+ * template <>
+ * struct secs::IsTriviallyRelocatable<Mesh> : std::true_type { };
+ * @endcode
+ */
+template <typename T>
+struct IsTriviallyRelocatable : std::bool_constant<std::is_trivially_copyable_v<T>> { };
 
-private:
-    ComponentHandle handle;
-    static inline uint32_t currentComponentHandle = 0;
-};
+template <typename T>
+constexpr bool isTriviallyRelocatable = IsTriviallyRelocatable<T>::value;
 
-} // namespace siren::ecs
+} // namespace secs
@@ -1,39 +1,82 @@
 #pragma once
 
-#include "ECSProperties.hpp"
-#include <typeindex>
+#include <atomic>
+#include <cstddef>
 
 #include "Assert.hpp"
+#include "Component.hpp"
+#include "ECSProperties.hpp"
 
 
 namespace secs
 {
 
-struct Component;
-
 /**
  * @brief This class handles assigning each Component Type a unique index in the range [0,
- * MAX_COMPONENTS]. This is used for setting the ComponentMask bits.
+ * MAX_COMPONENTS). This is used for setting the ComponentMask bits.
+ *
+ * Indices are handed out by an atomic counter the first time a type is used, and cached in a
+ * static local of getBitIndex<T>(), so no RTTI or map lookup is involved afterwards. Indices depend
+ * on the order types are first used in; registerComponents() fixes that order up front.
  */
 class ComponentBitMap
 {
 public:
     template <typename T>
-        requires(std::is_base_of_v<Component, T>)
+        requires(Component<T>)
     static size_t getBitIndex()
     {
-        SecsAssert(s_nextIndex <= MAX_COMPONENTS,
-                    "Cannot register more components than MAX_COMPONENTS allows!");
+        // initialized exactly once per type, even if systems running concurrently use a type for
+        // the first time at once
+        static const size_t index = assignIndex();
+        return index;
+    }
+
+    /// @brief Assigns the bit indices of all given types in order.
+    template <typename... Ts>
+        requires((Component<Ts> && ...))
+    static void registerComponents()
+    {
+        (getBitIndex<Ts>(), ...);
+    }
+
+private:
+    static inline std::atomic<size_t> s_nextIndex = 0;
 
-        const auto typeIndex = std::type_index(typeid(T));
-        if (!s_registry.contains(typeIndex)) { s_registry[typeIndex] = s_nextIndex++; }
+    static size_t assignIndex()
+    {
+        const size_t index = s_nextIndex.fetch_add(1, std::memory_order_relaxed);
+        SecsAssert(index < MAX_COMPONENTS,
+                    "Cannot register more components than MAX_COMPONENTS allows!");
+        return index;
+    }
+};
 
-        return s_registry[typeIndex];
+/**
+ * @brief Same as ComponentBitMap, but for singleton components. Singletons have an index space of
+ * their own, so they do not use up the ComponentMask bits of entity components.
+ */
+class SingletonBitMap
+{
+public:
+    template <typename T>
+        requires(Component<T>)
+    static size_t getBitIndex()
+    {
+        static const size_t index = assignIndex();
+        return index;
     }
 
 private:
-    static inline std::unordered_map<std::type_index, size_t> s_registry{};
-    static inline size_t s_nextIndex = 0;
+    static inline std::atomic<size_t> s_nextIndex = 0;
+
+    static size_t assignIndex()
+    {
+        const size_t index = s_nextIndex.fetch_add(1, std::memory_order_relaxed);
+        SecsAssert(index < MAX_COMPONENTS,
+                    "Cannot register more singletons than MAX_COMPONENTS allows!");
+        return index;
+    }
 };
 
 } // namespace siren::ecs
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "Component.hpp"
+
+
+namespace secs
+{
+
+/**
+ * @brief Type erased description of a component type. Allows storages that only know the bit
+ * index of a component (such as archetype chunks) to move, copy and destroy instances of it.
+ */
+struct ComponentInfo
+{
+    size_t size      = 0;
+    size_t alignment = 0;
+    /// @brief Move constructs the component at src into the uninitialized memory at dst and
+    /// destroys the component at src. Trivially relocatable components are copied byte wise.
+    void (*relocate)(void* dst, void* src) = nullptr;
+    /// @brief Destroys the component at ptr. Is nullptr for trivially destructible component
+    /// types, so storages can skip them entirely.
+    void (*destroy)(void* ptr) = nullptr;
+    /// @brief Copy constructs count copies of the component at src into the uninitialized array at
+    /// dst. Is nullptr for component types that can not be copied.
+    void (*copy)(void* dst, const void* src, size_t count) = nullptr;
+    /// @brief Tag components only exist as a bit of the archetype mask, without a column.
+    bool tag = false;
+
+    /// @brief Returns the ComponentInfo of type T.
+    template <typename T>
+    static ComponentInfo of()
+    {
+        ComponentInfo info{ sizeof(T), alignof(T) };
+        if constexpr (isTriviallyRelocatable<T>) {
+            info.relocate = [](void* dst, void* src) { std::memcpy(dst, src, sizeof(T)); };
+        } else {
+            info.relocate = [](void* dst, void* src) {
+                T* component = static_cast<T*>(src);
+                new(dst) T(std::move(*component));
+                component->~T();
+            };
+        }
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            info.destroy = [](void* ptr) { static_cast<T*>(ptr)->~T(); };
+        }
+        if constexpr (std::is_copy_constructible_v<T>) { info.copy = &copyMany<T>; }
+        info.tag = TagComponent<T>;
+        return info;
+    }
+
+    explicit operator bool() const { return relocate != nullptr; }
+
+private:
+    /// @brief Trivially copyable components are copied byte wise, all others are copy constructed.
+    template <typename T>
+    static void copyMany(void* dst, const void* src, const size_t count)
+    {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            auto* bytes = static_cast<std::byte*>(dst);
+            for (size_t i = 0; i < count; i++) {
+                std::memcpy(bytes + i * sizeof(T), src, sizeof(T));
+            }
+        } else {
+            std::uninitialized_fill_n(static_cast<T*>(dst), count, *static_cast<const T*>(src));
+        }
+    }
+};
+
+} // namespace secs
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "Component.hpp"
+
+
+namespace secs
+{
+
+/**
+ * @brief Selects how ComponentList stores a component type. By default components are stored as
+ * an array of structs. Aggregate components can opt into a struct of arrays layout by specializing
+ * this template with a Ref type, an aggregate holding a reference to each field in declaration
+ * order. Each field is then stored in its own column, and the scene hands out a Ref instead of a
+ * T&, which reads just like the component:
+ *
+ * @code
+ * struct Position { float x, y; };
+ *
+ * template <>
+ * struct secs::ComponentLayout<Position>
+ * {
+ *     struct Ref { float& x; float& y; };
+ *     // optional, stores the fields in blocks of 8 components instead of one array per field
+ *     static constexpr size_t LANES = 8;
+ * };
+ *
+ * scene.each<Position>([](secs::EntityHandle, auto pos) { pos.x += 1.0f; });
+ * @endcode
+ *
+ * With LANES the layout becomes an array of structs of arrays, which keeps the fields of a
+ * component close together while still allowing vector loads within a block. It requires all
+ * fields to be trivially copyable. Archetype storage keeps such components as structs, but hands
+ * out the same Ref so systems work with both storages.
+ *
+ * Components stored as structs can instead opt into paged storage by only defining a PAGE_SIZE.
+ * The components are then kept in pages of PAGE_SIZE components that are never reallocated, so
+ * adding components neither invalidates references to existing ones nor copies the whole array:
+ *
+ * @code
+ * template <>
+ * struct secs::ComponentLayout<Transform>
+ * {
+ *     static constexpr size_t PAGE_SIZE = 1024;
+ * };
+ * @endcode
+ *
+ * Removing a component still moves the last component of its list into the hole. Archetype
+ * storage ignores PAGE_SIZE, its chunks are never reallocated either, but components move whenever
+ * their entity changes archetype.
+ */
+template <typename T>
+struct ComponentLayout
+{
+};
+
+/// @brief The max amount of fields a struct of arrays component can have.
+constexpr size_t MAX_LAYOUT_FIELDS = 8;
+
+/// @brief Converts to any field type, used to count the fields of an aggregate.
+struct AnyField
+{
+    template <typename U>
+    operator U&() const&&;
+};
+
+/// @brief Checks if T can be brace initialized from sizeof...(I) values.
+template <typename T, size_t... I>
+constexpr bool isBraceConstructible(std::index_sequence<I...>)
+{
+    return requires { T{ (static_cast<void>(I), AnyField{ })... }; };
+}
+
+/// @brief Returns the amount of fields of the aggregate T. Fields that are aggregates themselves
+/// or arrays are not supported, as brace elision would count their members instead.
+template <typename T, size_t N = 0>
+constexpr size_t fieldCount()
+{
+    if constexpr (N <= MAX_LAYOUT_FIELDS
+                  && isBraceConstructible<T>(std::make_index_sequence<N + 1>{ })) {
+        return fieldCount<T, N + 1>();
+    } else {
+        return N;
+    }
+}
+
+/// @brief Returns a tuple of references to the fields of the aggregate component.
+template <typename T>
+auto fieldsOf(T& component)
+{
+    constexpr size_t count = fieldCount<T>();
+    static_assert(count > 0 && count <= MAX_LAYOUT_FIELDS, "Unsupported amount of fields");
+
+    if constexpr (count == 1) {
+        auto& [a] = component;
+        return std::tie(a);
+    } else if constexpr (count == 2) {
+        auto& [a, b] = component;
+        return std::tie(a, b);
+    } else if constexpr (count == 3) {
+        auto& [a, b, c] = component;
+        return std::tie(a, b, c);
+    } else if constexpr (count == 4) {
+        auto& [a, b, c, d] = component;
+        return std::tie(a, b, c, d);
+    } else if constexpr (count == 5) {
+        auto& [a, b, c, d, e] = component;
+        return std::tie(a, b, c, d, e);
+    } else if constexpr (count == 6) {
+        auto& [a, b, c, d, e, f] = component;
+        return std::tie(a, b, c, d, e, f);
+    } else if constexpr (count == 7) {
+        auto& [a, b, c, d, e, f, g] = component;
+        return std::tie(a, b, c, d, e, f, g);
+    } else {
+        auto& [a, b, c, d, e, f, g, h] = component;
+        return std::tie(a, b, c, d, e, f, g, h);
+    }
+}
+
+template <typename Tuple>
+struct RemoveReferences;
+
+template <typename... Fs>
+struct RemoveReferences<std::tuple<Fs&...>>
+{
+    using Type = std::tuple<Fs...>;
+};
+
+/// @brief The field types of the aggregate T as a std::tuple.
+template <typename T>
+using FieldTypes = typename RemoveReferences<decltype(fieldsOf(std::declval<T&>()))>::Type;
+
+/// @brief Components that opted into the struct of arrays layout through ComponentLayout.
+template <typename T>
+concept LayoutComponent = Component<T> && std::is_aggregate_v<T>
+                       && requires { typename ComponentLayout<T>::Ref; };
+
+/// @brief Returns the lane width of a LayoutComponent, or 0 if every field has a single column.
+template <typename T>
+constexpr size_t layoutLanes()
+{
+    if constexpr (requires { ComponentLayout<T>::LANES; }) {
+        return ComponentLayout<T>::LANES;
+    } else {
+        return 0;
+    }
+}
+
+/// @brief Returns the page size of a component, or 0 if it is not stored in pages.
+template <typename T>
+constexpr size_t layoutPageSize()
+{
+    if constexpr (requires { ComponentLayout<T>::PAGE_SIZE; }) {
+        return ComponentLayout<T>::PAGE_SIZE;
+    } else {
+        return 0;
+    }
+}
+
+/// @brief Components that opted into paged storage through the PAGE_SIZE of their ComponentLayout.
+template <typename T>
+concept PagedComponent = Component<T> && !LayoutComponent<T> && layoutPageSize<T>() > 0;
+
+/**
+ * @brief Pointer like wrapper around a Ref, handed out where plain components hand out a T*.
+ */
+template <typename Ref>
+class RefPointer
+{
+public:
+    RefPointer() = default;
+    RefPointer(std::nullptr_t) { }
+    explicit RefPointer(const Ref& ref) : m_ref(ref) { }
+
+    RefPointer(const RefPointer&) = default;
+
+    /// @brief Refs can not be assigned as they hold references, so the Ref is rebuilt instead.
+    RefPointer& operator=(const RefPointer& other)
+    {
+        m_ref.reset();
+        if (other.m_ref) { m_ref.emplace(*other.m_ref); }
+        return *this;
+    }
+
+    /// @brief The references of a Ref stay writable through a const Ref.
+    const Ref& operator*() const { return *m_ref; }
+    const Ref* operator->() const { return &*m_ref; }
+
+    explicit operator bool() const { return m_ref.has_value(); }
+    bool operator==(std::nullptr_t) const { return !m_ref; }
+
+private:
+    std::optional<Ref> m_ref{ };
+};
+
+template <typename T>
+struct ComponentAccess
+{
+    using Ref     = T&;
+    using Pointer = T*;
+};
+
+template <typename T>
+    requires(LayoutComponent<T>)
+struct ComponentAccess<T>
+{
+    using Ref     = typename ComponentLayout<T>::Ref;
+    using Pointer = RefPointer<Ref>;
+};
+
+/// @brief What the scene hands out for a component of type T, T& or its ComponentLayout Ref.
+template <typename T>
+using ComponentRef = typename ComponentAccess<T>::Ref;
+
+/// @brief What the scene hands out for an optional component of type T, T* or a RefPointer.
+template <typename T>
+using ComponentPtr = typename ComponentAccess<T>::Pointer;
+
+/// @brief Returns the ComponentRef of a component stored as a struct.
+template <typename T>
+ComponentRef<T> makeRef(T& component)
+{
+    if constexpr (LayoutComponent<T>) {
+        return std::apply(
+            [](auto&... fields) { return ComponentRef<T>{ fields... }; },
+            fieldsOf(component)
+        );
+    } else {
+        return component;
+    }
+}
+
+/// @brief Returns the ComponentPtr of a component, or of nothing if component is nullptr.
+template <typename T>
+ComponentPtr<T> makePointer(T* component)
+{
+    if constexpr (LayoutComponent<T>) {
+        if (!component) { return nullptr; }
+        return ComponentPtr<T>{ makeRef(*component) };
+    } else {
+        return component;
+    }
+}
+
+/// @brief Returns the ComponentPtr of a ComponentRef.
+template <typename T>
+ComponentPtr<T> addressOf(const ComponentRef<T> ref)
+{
+    if constexpr (LayoutComponent<T>) {
+        return ComponentPtr<T>{ ref };
+    } else {
+        return &ref;
+    }
+}
+
+} // namespace secs
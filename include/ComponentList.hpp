@@ -1,9 +1,19 @@
 #pragma once
 
-#include <unordered_map>
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
 
 #include "Assert.hpp"
+#include "ChangeTicks.hpp"
 #include "Component.hpp"
+#include "ComponentStorage.hpp"
+#include "EntityHandle.hpp"
+#include "Growth.hpp"
+#include "SoAVector.hpp"
 
 
 namespace secs
@@ -17,62 +27,262 @@ class IComponentList
 public:
     virtual ~IComponentList() = default;
 
-    virtual void remove(ComponentHandle handle) = 0;
+    virtual void remove(EntityHandle entity) = 0;
+
+    /// @brief Removes the components of all given entities that have one in this list.
+    virtual void removeMany(std::span<const EntityHandle> entities) = 0;
+
+    /// @brief Removes all components of this list.
+    virtual void clear() = 0;
+
+    /// @brief Appends a copy of the component of source for each of the given entities, marked as
+    /// added at the given tick.
+    virtual void copy(EntityHandle source, std::span<const EntityHandle> entities, Tick tick) = 0;
+
+    /// @brief Returns the amount of components in this list.
+    [[nodiscard]] virtual size_t size() const = 0;
+
+    /// @brief Returns the entities owning a component in this list, in storage order.
+    [[nodiscard]] virtual std::span<const EntityHandle> entities() const = 0;
+
+    /// @brief Releases all memory that is not needed to hold the current components.
+    virtual void shrinkToFit() = 0;
 };
 
 /**
- * @brief Represents a list of a single component type.
+ * @brief Represents a list of a single component type, stored as a sparse set. A paged sparse
+ * array maps each entity index to a slot in the dense arrays, which hold the components, the
+ * entity owning them and the ticks they were added and last changed at. The components are kept in
+ * the container selected by their ComponentLayout, see DenseStorage.
  */
 template <typename T>
-    requires(std::is_base_of_v<Component, T>)
+    requires(Component<T>)
 class ComponentList final : public IComponentList
 {
 public:
-    /// @brief Creates a new component at the back of the list and returns it.
+    /// @brief The amount of entity indices covered by a single page of the sparse array.
+    static constexpr size_t PAGE_SIZE = 4096;
+
+    /// @brief Creates a new component for the entity at the back of the list and returns it. The
+    /// component is marked as added and changed at the given tick.
     template <typename... Args>
-    T& emplace(Args&&... args)
+    ComponentRef<T> emplace(const EntityHandle entity, const Tick tick, Args&&... args)
     {
-        m_list.emplace_back(args...);
-        const size_t index                                     = m_list.size() - 1;
-        m_componentToIndex[m_list.back().getComponentHandle()] = index;
+        SecsAssert(!contains(entity), "Entity already has a component in this ComponentList");
+
+        m_list.emplaceBack(std::forward<Args>(args)...);
+        m_entities.push_back(entity);
+        m_ticks.push_back(ComponentTicks{ tick, tick });
+        getCreateSlot(entity.index()) = static_cast<uint32_t>(m_list.size() - 1);
         return m_list.back();
     }
 
-    /// @brief Removes a component from the list
-    void remove(const ComponentHandle handle) override
+    /// @brief Reserves room for the given amount of components in the dense arrays.
+    void reserve(const size_t count)
+    {
+        m_list.reserve(count);
+        m_entities.reserve(count);
+        m_ticks.reserve(count);
+    }
+
+    /// @brief Makes room for count more components, growing the dense arrays geometrically so
+    /// adding components in many small batches does not reallocate on every batch.
+    void reserveMore(const size_t count)
+    {
+        reserve(grownCapacity(m_entities.capacity(), m_entities.size() + count));
+    }
+
+    /// @brief Releases the unused capacity of the dense arrays and all sparse pages that no longer
+    /// map any entity.
+    void shrinkToFit() override
+    {
+        m_list.shrinkToFit();
+        m_entities.shrink_to_fit();
+        m_ticks.shrink_to_fit();
+
+        const auto isEmpty = [](const Page& page) {
+            return std::ranges::all_of(page, [](const uint32_t slot) {
+                return slot == INVALID_SLOT;
+            });
+        };
+        for (auto& page : m_sparse) {
+            if (page && isEmpty(*page)) { page.reset(); }
+        }
+        while (!m_sparse.empty() && !m_sparse.back()) { m_sparse.pop_back(); }
+        m_sparse.shrink_to_fit();
+    }
+
+    /// @brief Removes the component of the entity from the list
+    void remove(const EntityHandle entity) override
+    {
+        const uint32_t slot = find(entity);
+        if (slot == INVALID_SLOT) { return; }
+
+        getSlot(entity.index()) = INVALID_SLOT;
+        removeSlot(slot);
+    }
+
+    /// @brief Removes the components of all given entities that have one in this list. The slots
+    /// of the entities are unmapped in a first pass, then freed from the highest down, so each hole
+    /// is filled by a component that stays and every entity is looked up only once.
+    void removeMany(const std::span<const EntityHandle> entities) override
+    {
+        // reused across calls, per thread as separate scenes may be used from different threads
+        static thread_local std::vector<uint32_t> slots{ };
+        slots.clear();
+        for (const EntityHandle entity : entities) {
+            const uint32_t slot = find(entity);
+            if (slot == INVALID_SLOT) { continue; }
+            getSlot(entity.index()) = INVALID_SLOT;
+            slots.push_back(slot);
+        }
+        if (slots.empty()) { return; }
+
+        std::ranges::sort(slots, std::greater{ });
+        for (const uint32_t slot : slots) { removeSlot(slot); }
+    }
+
+    /// @brief Removes all components of this list by truncating the dense arrays. Only the sparse
+    /// entries of the stored entities are reset, so the pages stay allocated.
+    void clear() override
+    {
+        for (const EntityHandle entity : m_entities) { getSlot(entity.index()) = INVALID_SLOT; }
+        m_list.clear();
+        m_entities.clear();
+        m_ticks.clear();
+    }
+
+    /// @brief Appends a copy of the component of source for each of the given entities, marked as
+    /// added at the given tick. The copies are placed next to each other at the back of the list.
+    /// The entities must not have a component in this list yet.
+    void copy(
+        const EntityHandle source,
+        const std::span<const EntityHandle> entities,
+        const Tick tick
+    ) override
+    {
+        const uint32_t slot = find(source);
+        SecsAssert(slot != INVALID_SLOT, "Failed to get Component from ComponentList");
+
+        if constexpr (std::is_copy_constructible_v<T>) {
+            reserveMore(entities.size());
+            m_list.appendCopies(slot, entities.size());
+            m_ticks.insert(m_ticks.end(), entities.size(), ComponentTicks{ tick, tick });
+            for (const EntityHandle entity : entities) {
+                m_entities.push_back(entity);
+                getCreateSlot(entity.index()) = static_cast<uint32_t>(m_entities.size() - 1);
+            }
+        } else {
+            SecsAssert(false, "Attempting to copy a component that is not copyable");
+        }
+    }
+
+    /// @brief Returns the component instance of the given entity.
+    ComponentRef<T> get(const EntityHandle entity)
+    {
+        const uint32_t slot = find(entity);
+        SecsAssert(slot != INVALID_SLOT, "Failed to get Component from ComponentList");
+        return m_list[slot];
+    }
+
+    /// @brief Returns the component instance of the given entity.
+    ComponentPtr<T> getSafe(const EntityHandle entity)
     {
-        if (!m_componentToIndex.contains(handle)) { return; }
+        const uint32_t slot = find(entity);
+        if (slot == INVALID_SLOT) { return nullptr; }
+        return addressOf<T>(m_list[slot]);
+    }
 
-        // swap with last and pop back
-        const size_t index = m_componentToIndex[handle];
-        std::swap(m_list[index], m_list.back());
-        m_list.pop_back();
-        m_componentToIndex[m_list[index].getComponentHandle()] = index;
+    /// @brief Returns the ticks of the entities component, or nullptr if it has none.
+    [[nodiscard]] const ComponentTicks* getTicks(const EntityHandle entity) const
+    {
+        const uint32_t slot = find(entity);
+        if (slot == INVALID_SLOT) { return nullptr; }
+        return &m_ticks[slot];
     }
 
-    /// @brief Returns the component instance with the given handle.
-    T& get(const ComponentHandle handle)
+    /// @brief Marks the entities component as changed at the given tick.
+    void markChanged(const EntityHandle entity, const Tick tick)
     {
-        SecsAssert(
-            m_componentToIndex.contains(handle),
-            "Failed to get Component from ComponentList"
-        );
-        return m_list[m_componentToIndex.at(handle)];
+        const uint32_t slot = find(entity);
+        if (slot != INVALID_SLOT) { m_ticks[slot].changed = tick; }
     }
 
-    /// @brief Returns the component instance with the given handle.
-    T* getSafe(const ComponentHandle handle)
+    /// @brief Checks if the entity has a component in this list.
+    [[nodiscard]] bool contains(const EntityHandle entity) const
     {
-        if (!m_componentToIndex.contains(handle)) { return nullptr; }
-        return &m_list[m_componentToIndex.at(handle)];
+        return find(entity) != INVALID_SLOT;
     }
 
+    /// @brief Returns the amount of components in this list.
+    [[nodiscard]] size_t size() const override { return m_list.size(); }
+
+    /// @brief Returns the entities owning a component in this list, in storage order.
+    [[nodiscard]] std::span<const EntityHandle> entities() const override { return m_entities; }
+
+    /// @brief Returns raw access to the dense arrays of this list.
+    ComponentStorage<T> storage() { return ComponentStorage<T>{ m_list, m_entities }; }
+
 private:
-    /// @brief The dense list of Components.
-    std::vector<T> m_list{ };
-    /// @brief A mapping of @ref ComponentHandle to its index in the list. Can also be used to test
-    /// if the IComponent exists in the list.
-    std::unordered_map<ComponentHandle, size_t> m_componentToIndex{ };
+    /// @brief Value of a sparse entry whose entity has no component in this list.
+    static constexpr uint32_t INVALID_SLOT = UINT32_MAX;
+
+    using Page = std::array<uint32_t, PAGE_SIZE>;
+
+    /// @brief The dense list of Components, split into columns for LayoutComponents.
+    typename DenseStorage<T>::Type m_list{ };
+    /// @brief The entity owning each component in m_list.
+    std::vector<EntityHandle> m_entities{ };
+    /// @brief The added and changed ticks of each component in m_list.
+    std::vector<ComponentTicks> m_ticks{ };
+    /// @brief Paged mapping of entity index to its slot in m_list. Pages are only allocated once an
+    /// entity index inside of them receives a component.
+    std::vector<std::unique_ptr<Page>> m_sparse{ };
+
+    /// @brief Returns the slot of the entity, or INVALID_SLOT if it has no component in this list.
+    /// Stale handles whose index has been reused by another entity are detected by comparing
+    /// against the owning entity.
+    [[nodiscard]] uint32_t find(const EntityHandle entity) const
+    {
+        const size_t page = entity.index() / PAGE_SIZE;
+        if (page >= m_sparse.size() || !m_sparse[page]) { return INVALID_SLOT; }
+
+        const uint32_t slot = (*m_sparse[page])[entity.index() % PAGE_SIZE];
+        if (slot == INVALID_SLOT || m_entities[slot] != entity) { return INVALID_SLOT; }
+        return slot;
+    }
+
+    /// @brief Frees the given slot by moving the last component into it. The sparse entry of the
+    /// entity owning the slot must have been reset already.
+    void removeSlot(const uint32_t slot)
+    {
+        if (slot != m_list.size() - 1) {
+            m_entities[slot]                  = m_entities.back();
+            m_ticks[slot]                     = m_ticks.back();
+            getSlot(m_entities[slot].index()) = slot;
+        }
+        m_list.swapRemove(slot);
+        m_entities.pop_back();
+        m_ticks.pop_back();
+    }
+
+    /// @brief Returns the slot of an entity that is known to be in this list.
+    uint32_t& getSlot(const EntityIndex entity)
+    {
+        return (*m_sparse[entity / PAGE_SIZE])[entity % PAGE_SIZE];
+    }
+
+    /// @brief Returns the slot of an entity, allocating its page if required.
+    uint32_t& getCreateSlot(const EntityIndex entity)
+    {
+        const size_t page = entity / PAGE_SIZE;
+        if (page >= m_sparse.size()) { m_sparse.resize(page + 1); }
+        if (!m_sparse[page]) {
+            m_sparse[page] = std::make_unique<Page>();
+            m_sparse[page]->fill(INVALID_SLOT);
+        }
+        return (*m_sparse[page])[entity % PAGE_SIZE];
+    }
 };
 
 } // namespace siren::ecs
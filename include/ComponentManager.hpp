@@ -1,7 +1,16 @@
 #pragma once
 
+#include <array>
+#include <memory>
+#include <span>
+#include <tuple>
+#include <utility>
+
+#include "Bundle.hpp"
 #include "ComponentList.hpp"
 #include "EntityManager.hpp"
+#include "JobSystem.hpp"
+#include "Query.hpp"
 
 
 namespace secs
@@ -14,107 +23,255 @@ namespace secs
 class ComponentManager
 {
 public:
-    /// @brief Create Component of type T and assign it to the provided entity. If the entity
-    /// already has a component of this type, do nothing.
+    /// @brief Create Component of type T and assign it to the provided entity, marking it as added
+    /// at the given tick. If the entity already has a component of this type, do nothing.
     template <typename T, typename... Args>
-        requires(std::is_base_of_v<Component, T>)
-    T& emplace(const EntityHandle entity, Args&&... args)
+        requires(Component<T>)
+    ComponentRef<T> emplace(const EntityHandle entity, const Tick tick, Args&&... args)
     {
-        const size_t componentIndex = ComponentBitMap::getBitIndex<T>();
-        if (hasComponent<T>(entity)) {
-            ComponentList<T>& list       = getCreateComponentList<T>();
-            const ComponentHandle handle = m_entityToComponent[entity][componentIndex];
-            return list.get(handle);
+        if constexpr (TagComponent<T>) {
+            // tags only live in the entities mask
+            return tagInstance<T>();
+        } else {
+            ComponentList<T>& list = getCreateComponentList<T>();
+            if (list.contains(entity)) { return list.get(entity); }
+
+            return list.emplace(entity, tick, std::forward<Args>(args)...);
+        }
+    }
+
+    /// @brief Creates the lists of all given types up front.
+    template <typename... Ts>
+        requires((Component<Ts> && ...))
+    void registerComponents()
+    {
+        (getCreateComponentList<Ts>(), ...);
+    }
+
+    /// @brief Reserves room for count components of type T.
+    template <typename T>
+        requires(Component<T>)
+    void reserve(const size_t count)
+    {
+        getCreateComponentList<T>().reserve(count);
+    }
+
+    /// @brief Releases the unused memory of all component lists.
+    void shrinkToFit()
+    {
+        for (const auto& list : m_components) {
+            if (list) { list->shrinkToFit(); }
         }
+    }
+
+    /// @brief Moves the components of the bundle into their lists, skipping the types the entity
+    /// already has.
+    template <typename... Ts>
+    void emplace(const EntityHandle entity, const Tick tick, Bundle<Ts...>&& bundle)
+    {
+        (emplace<Ts>(entity, tick, std::move(std::get<Ts>(bundle.components))), ...);
+    }
 
-        ComponentList<T>& list = getCreateComponentList<T>();
+    /// @brief Should be called after the given entities have been created. Adds the components of
+    /// the bundle makeBundle(i) returns to the i-th entity, reserving each list once up front.
+    template <typename... Ts, typename Fn>
+    void createMany(const std::span<const EntityHandle> entities, const Tick tick, Fn& makeBundle)
+    {
+        // look up each list once instead of once per entity, tags have none
+        std::tuple<ComponentList<Ts>*...> lists{ bundleList<Ts>()... };
+        std::apply(
+            [&](auto*... list) {
+                ((list ? list->reserveMore(entities.size()) : void()), ...);
+            },
+            lists
+        );
 
-        T& component                                       = list.emplace(std::forward<Args>(args)...);
-        m_componentToIndex[component.getComponentHandle()] = componentIndex;
-        m_entityToComponent[entity][componentIndex]        = component.getComponentHandle();
+        for (size_t i = 0; i < entities.size(); i++) {
+            Bundle<Ts...> bundle = makeBundle(i);
+            auto& components     = bundle.components;
+            std::apply(
+                [&](ComponentList<Ts>*... list) {
+                    (emplaceInto(list, entities[i], tick, std::get<Ts>(components)), ...);
+                },
+                lists
+            );
+        }
+    }
 
-        return component;
+    /// @brief Should be called after the given entities have been created as copies of source. Adds
+    /// a copy of each component of source whose bit is set in mask to every entity.
+    void instantiate(
+        const EntityHandle source,
+        const ComponentMask& mask,
+        const std::span<const EntityHandle> entities,
+        const Tick tick
+    )
+    {
+        for (size_t i = 0; i < MAX_COMPONENTS; i++) {
+            // tags have no list, their bits are already part of mask
+            if (mask.test(i) && m_components[i]) { m_components[i]->copy(source, entities, tick); }
+        }
     }
 
     /// @brief Removes the Component of type T from entity. If entity does not have a component of
     /// type T, do nothing.
     template <typename T>
-        requires(std::is_base_of_v<Component, T>)
+        requires(Component<T>)
     void remove(const EntityHandle entity)
     {
-        if (!hasComponent<T>(entity)) { return; }
-
-        const size_t componentIndex     = ComponentBitMap::getBitIndex<T>();
-        ComponentHandle componentHandle = m_entityToComponent[entity][componentIndex];
-        ComponentList<T>& list          = getCreateComponentList<T>();
-
-        m_componentToIndex.erase(componentHandle);
-        m_entityToComponent[entity][componentIndex] = INVALID_COMPONENT;
-        list.remove(componentHandle);
+        if constexpr (!TagComponent<T>) {
+            if (ComponentList<T>* list = getComponentList<T>()) { list->remove(entity); }
+        }
     }
 
     /// @brief Should be called each time an entity is destroyed. Removes all state stored about
     /// this entity.
     void destroy(const EntityHandle entity)
     {
-        if (!m_entityToComponent.contains(entity)) { return; }
+        for (const auto& list : m_components) {
+            if (list) { list->remove(entity); }
+        }
+    }
+
+    /// @brief Removes all components of the given entities. Each list is visited once for the
+    /// whole batch instead of once per entity.
+    void destroyMany(const std::span<const EntityHandle> entities)
+    {
+        for (const auto& list : m_components) {
+            if (list) { list->removeMany(entities); }
+        }
+    }
 
-        for (const auto& componentHandle : m_entityToComponent[entity]) {
-            if (componentHandle == INVALID_COMPONENT) { continue; }
-            const size_t index = m_componentToIndex[componentHandle];
-            m_components[index]->remove(componentHandle);
-            m_componentToIndex.erase(componentHandle);
+    /// @brief Removes all components of all entities.
+    void destroyAll()
+    {
+        for (const auto& list : m_components) {
+            if (list) { list->clear(); }
         }
+    }
 
-        m_entityToComponent.erase(entity);
+    /// @brief Removes the components of type T from all entities.
+    template <typename T>
+        requires(Component<T>)
+    void clear()
+    {
+        if (ComponentList<T>* list = getComponentList<T>()) { list->clear(); }
+    }
+
+    /// @brief Returns all entities that have a component of type T.
+    template <typename T>
+        requires(Component<T>)
+    std::span<const EntityHandle> getEntities() const
+    {
+        const ComponentList<T>* list = getComponentList<T>();
+        if (!list) { return { }; }
+        return list->entities();
+    }
+
+    /// @brief Returns raw access to the dense arrays of component type T, which are empty if no
+    /// component of type T exists yet.
+    template <typename T>
+        requires(Component<T>)
+    ComponentStorage<T> storage() const
+    {
+        ComponentList<T>* list = getComponentList<T>();
+        if (!list) { return ComponentStorage<T>{ }; }
+        return list->storage();
     }
 
     /// @brief An unsafe get of the component of type T associated with the given entity
     template <typename T>
-        requires(std::is_base_of_v<Component, T>)
-    T& get(const EntityHandle entity) const
+        requires(Component<T>)
+    ComponentRef<T> get(const EntityHandle entity) const
     {
-        const size_t componentIndex  = ComponentBitMap::getBitIndex<T>();
-        const ComponentHandle handle = m_entityToComponent.at(entity)[componentIndex];
-        ComponentList<T>& list       = getCreateComponentList<T>();
-        return list.get(handle);
+        ComponentList<T>* list = getComponentList<T>();
+        SecsAssert(list, "Failed to get Component from ComponentList");
+        return list->get(entity);
     }
 
     /// @brief A safe get of the component of type T associated with the given entity
     template <typename T>
-        requires(std::is_base_of_v<Component, T>)
-    T* getSafe(const EntityHandle entity) const
+        requires(Component<T>)
+    ComponentPtr<T> getSafe(const EntityHandle entity) const
+    {
+        ComponentList<T>* list = getComponentList<T>();
+        if (!list) { return nullptr; }
+        return list->getSafe(entity);
+    }
+
+    /// @brief Marks the component of type T of the entity as changed at the given tick.
+    template <typename T>
+        requires(Component<T>)
+    void markChanged(const EntityHandle entity, const Tick tick)
+    {
+        if (ComponentList<T>* list = getComponentList<T>()) { list->markChanged(entity, tick); }
+    }
+
+    /// @brief Returns the change ticks of the component of type T of the entity, or nullptr.
+    template <typename T>
+        requires(Component<T>)
+    const ComponentTicks* getTicks(const EntityHandle entity) const
     {
-        const size_t componentIndex  = ComponentBitMap::getBitIndex<T>();
-        const ComponentHandle handle = m_entityToComponent.at(entity)[componentIndex];
-        ComponentList<T>& list       = getCreateComponentList<T>();
-        return list.getSafe(handle);
+        const ComponentList<T>* list = getComponentList<T>();
+        if (!list) { return nullptr; }
+        return list->getTicks(entity);
     }
 
     /// @brief Checks if the entity has this component type.
     template <typename T>
-        requires(std::is_base_of_v<Component, T>)
+        requires(Component<T>)
     bool hasComponent(const EntityHandle entity) const
     {
-        const size_t componentIndex = ComponentBitMap::getBitIndex<T>();
-        if (!m_entityToComponent.contains(entity)) { return false; }
-        return m_entityToComponent.at(entity)[componentIndex] != INVALID_COMPONENT;
+        const auto& list = m_components[ComponentBitMap::getBitIndex<T>()];
+        return list && static_cast<const ComponentList<T>&>(*list).contains(entity);
+    }
+
+    /// @brief Calls fn(EntityHandle, ...) for every entity matching the query terms, passing T& for
+    /// each required component and T* for each Optional<T>. The smallest list of a required
+    /// component drives the iteration, and every candidate is filtered by a single mask test.
+    /// Added<T> and Changed<T> terms compare the component ticks against since. Adding or removing
+    /// components or entities inside fn is not allowed.
+    template <typename... Terms, typename Fn>
+    void each(const EntityManager& entityManager, const Tick since, Fn&& fn) const
+    {
+        const auto run = [](const size_t count, const auto& body) { body(size_t{ 0 }, count); };
+        eachImpl<Terms...>(entityManager, since, fn, run, std::index_sequence_for<Terms...>{ });
+    }
+
+    /// @brief Same as each(), but splits the driving list into ranges of grain entities which are
+    /// processed as jobs, so fn may be called concurrently.
+    template <typename... Terms, typename Fn>
+    void parEach(
+        const EntityManager& entityManager,
+        const Tick since,
+        JobSystem& jobs,
+        const size_t grain,
+        Fn&& fn
+    ) const
+    {
+        const auto run = [&jobs, grain](const size_t count, const auto& body) {
+            jobs.parallelFor(count, grain, body);
+        };
+        eachImpl<Terms...>(entityManager, since, fn, run, std::index_sequence_for<Terms...>{ });
     }
 
 private:
-    /// @brief All the component lists
-    mutable std::array<std::shared_ptr<IComponentList>, MAX_COMPONENTS> m_components{ };
-    /// @brief Mapping of EntityHandle to its assigned componentID's. Indexing into the vector is
-    /// done by taking the component types index via the ComponentBitMap.
-    std::unordered_map<EntityHandle, std::array<ComponentHandle, MAX_COMPONENTS>> m_entityToComponent{ };
-    // HACK: this is a terrible solution, but cant think of anything better for now
-    /// @brief A mapping of each ComponentHandle to it index into m_components
-    std::unordered_map<ComponentHandle, size_t> m_componentToIndex{ };
+    /// @brief All the component lists. Lists are only created by non const members, so concurrent
+    /// readers never write to this array.
+    std::array<std::shared_ptr<IComponentList>, MAX_COMPONENTS> m_components{ };
+
+    /// @brief Returns the list of type T, or nullptr if no component of type T exists yet.
+    template <typename T>
+        requires(Component<T>)
+    ComponentList<T>* getComponentList() const
+    {
+        return static_cast<ComponentList<T>*>(m_components[ComponentBitMap::getBitIndex<T>()].get());
+    }
 
     /// @brief Returns a list reference of type T.
     template <typename T>
-        requires(std::is_base_of_v<Component, T>)
-    ComponentList<T>& getCreateComponentList() const
+        requires(Component<T>)
+    ComponentList<T>& getCreateComponentList()
     {
         const size_t componentIndex = ComponentBitMap::getBitIndex<T>();
         if (!m_components[componentIndex]) {
@@ -122,6 +279,119 @@ private:
         }
         return static_cast<ComponentList<T>&>(*m_components[componentIndex]);
     }
+
+    /// @brief Selects the driving list of the query and hands ranges of it to run, which calls
+    /// the given body(begin, end) on them either inline or as jobs.
+    template <typename... Terms, typename Fn, typename Run, size_t... I>
+    void eachImpl(
+        const EntityManager& entityManager,
+        const Tick since,
+        Fn& fn,
+        const Run& run,
+        std::index_sequence<I...>
+    ) const
+    {
+        const QueryMask query = makeQueryMask<Terms...>();
+
+        // a missing required list means no entity can match, tags are only checked by the mask
+        const auto lists = std::make_tuple(queryList<Terms>()...);
+        if (((isStoredRequiredTerm<Terms>() && !std::get<I>(lists)) || ...)) { return; }
+
+        std::span<const EntityHandle> driver = entityManager.alive();
+        const auto selectDriver = [&driver](const IComponentList* list) {
+            if (list->size() < driver.size()) { driver = list->entities(); }
+        };
+        ((isStoredRequiredTerm<Terms>() ? selectDriver(std::get<I>(lists)) : void()), ...);
+
+        run(driver.size(), [&](const size_t begin, const size_t end) {
+            for (const EntityHandle entity : driver.subspan(begin, end - begin)) {
+                const ComponentMask mask = entityManager.getMask(entity);
+                if (!query.matches(mask)) { continue; }
+                if (!(passes<Terms>(std::get<I>(lists), entity, since) && ...)) { continue; }
+
+                std::apply(
+                    fn,
+                    std::tuple_cat(
+                        std::make_tuple(entity),
+                        fetch<Terms>(std::get<I>(lists), entity, mask)...
+                    )
+                );
+            }
+        });
+    }
+
+    /// @brief Returns the list a query term reads from, or nullptr for terms without a list.
+    template <typename Term>
+    auto queryList() const
+    {
+        if constexpr ((isFetchedTerm<Term>() || isTickTerm<Term>()) && !isTagTerm<Term>()) {
+            return getComponentList<typename QueryTerm<Term>::Type>();
+        } else {
+            return static_cast<const IComponentList*>(nullptr);
+        }
+    }
+
+    /// @brief Checks if the entity passes the tick filter of a query term. Terms without a tick
+    /// filter always pass.
+    template <typename Term, typename List>
+    static bool passes(List* list, const EntityHandle entity, const Tick since)
+    {
+        if constexpr (isTickTerm<Term>()) {
+            return QueryTerm<Term>::passes(*list->getTicks(entity), since);
+        } else {
+            return true;
+        }
+    }
+
+    /// @brief Checks if the term requires a component that is kept in a list.
+    template <typename Term>
+    static constexpr bool isStoredRequiredTerm()
+    {
+        return isRequiredTerm<Term>() && !isTagTerm<Term>();
+    }
+
+    /// @brief Returns the list of the components of a bundle, or nullptr for tags.
+    template <typename T>
+    ComponentList<T>* bundleList()
+    {
+        if constexpr (TagComponent<T>) {
+            return nullptr;
+        } else {
+            return &getCreateComponentList<T>();
+        }
+    }
+
+    /// @brief Moves a component of a bundle into its list. Tags are skipped.
+    template <typename T>
+    static void emplaceInto(
+        ComponentList<T>* list,
+        const EntityHandle entity,
+        const Tick tick,
+        T& component
+    )
+    {
+        if constexpr (!TagComponent<T>) { list->emplace(entity, tick, std::move(component)); }
+    }
+
+    /// @brief Returns the arguments a query term hands out for the given entity. Tags hand out
+    /// their single instance, depending on the entities mask.
+    template <typename Term, typename List>
+    static auto fetch(List* list, const EntityHandle entity, const ComponentMask& mask)
+    {
+        using T = typename QueryTerm<Term>::Type;
+        if constexpr (isTagTerm<Term>() && QueryTerm<Term>::KIND == REQUIRED_TERM) {
+            return std::tuple<T&>{ tagInstance<T>() };
+        } else if constexpr (isTagTerm<Term>() && QueryTerm<Term>::KIND == OPTIONAL_TERM) {
+            const bool has = mask.test(ComponentBitMap::getBitIndex<T>());
+            return std::make_tuple(has ? &tagInstance<T>() : nullptr);
+        } else if constexpr (QueryTerm<Term>::KIND == REQUIRED_TERM) {
+            return std::tuple<ComponentRef<T>>{ list->get(entity) };
+        } else if constexpr (QueryTerm<Term>::KIND == OPTIONAL_TERM) {
+            return std::make_tuple(list ? list->getSafe(entity) : ComponentPtr<T>{ nullptr });
+        } else {
+            return std::tuple<>{ };
+        }
+    }
 };
 
 } // namespace siren::ecs
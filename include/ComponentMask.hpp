@@ -0,0 +1,195 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+#include "Assert.hpp"
+#include "ECSProperties.hpp"
+
+
+namespace secs
+{
+
+/**
+ * @brief A bitmask used to indicate what components an entity has assigned. Each component type
+ * owns the bit given by ComponentBitMap.
+ *
+ * The bits are stored as MAX_COMPONENTS / 64 words, aligned so that wide masks can be tested with
+ * single SSE4.1 or AVX2 instructions. The tests used by queries take the amount of leading words to
+ * look at, so queries only pay for the words their components live in, not for the full width.
+ */
+class alignas(std::min<size_t>(MAX_COMPONENTS / 8, 32)) ComponentMask
+{
+public:
+    /// @brief The amount of 64 bit words a mask consists of.
+    static constexpr size_t WORDS = MAX_COMPONENTS / 64;
+
+    /// @brief Checks if the bit at the given index is set.
+    [[nodiscard]] bool test(const size_t index) const
+    {
+        SecsAssert(index < MAX_COMPONENTS, "ComponentMask index out of range");
+        return (m_words[index / 64] >> (index % 64)) & 1;
+    }
+
+    /// @brief Sets the bit at the given index.
+    ComponentMask& set(const size_t index)
+    {
+        SecsAssert(index < MAX_COMPONENTS, "ComponentMask index out of range");
+        m_words[index / 64] |= uint64_t{ 1 } << (index % 64);
+        return *this;
+    }
+
+    /// @brief Clears the bit at the given index.
+    ComponentMask& reset(const size_t index)
+    {
+        SecsAssert(index < MAX_COMPONENTS, "ComponentMask index out of range");
+        m_words[index / 64] &= ~(uint64_t{ 1 } << (index % 64));
+        return *this;
+    }
+
+    /// @brief Clears all bits.
+    ComponentMask& reset()
+    {
+        m_words.fill(0);
+        return *this;
+    }
+
+    /// @brief Checks if any bit is set.
+    [[nodiscard]] bool any() const
+    {
+        return std::ranges::any_of(m_words, [](const uint64_t word) { return word != 0; });
+    }
+
+    /// @brief Checks if no bit is set.
+    [[nodiscard]] bool none() const { return !any(); }
+
+    /// @brief Returns the amount of set bits.
+    [[nodiscard]] size_t count() const
+    {
+        size_t count = 0;
+        for (const uint64_t word : m_words) { count += std::popcount(word); }
+        return count;
+    }
+
+    /// @brief Returns the amount of leading words that hold set bits.
+    [[nodiscard]] size_t usedWords() const
+    {
+        size_t words = WORDS;
+        while (words > 0 && m_words[words - 1] == 0) { words--; }
+        return words;
+    }
+
+    /// @brief Checks if all bits of other are set in this mask, looking at the first words only.
+    [[nodiscard]] bool containsAll(const ComponentMask& other, const size_t words = WORDS) const
+    {
+        size_t word = 0;
+#if defined(__AVX2__)
+        for (; word + 4 <= words; word += 4) {
+            if (!_mm256_testc_si256(load256(word), other.load256(word))) { return false; }
+        }
+#endif
+#if defined(__SSE4_1__)
+        for (; word + 2 <= words; word += 2) {
+            if (!_mm_testc_si128(load128(word), other.load128(word))) { return false; }
+        }
+#endif
+        for (; word < words; word++) {
+            if ((m_words[word] & other.m_words[word]) != other.m_words[word]) { return false; }
+        }
+        return true;
+    }
+
+    /// @brief Checks if any bit of other is set in this mask, looking at the first words only.
+    [[nodiscard]] bool intersects(const ComponentMask& other, const size_t words = WORDS) const
+    {
+        size_t word = 0;
+#if defined(__AVX2__)
+        for (; word + 4 <= words; word += 4) {
+            if (!_mm256_testz_si256(load256(word), other.load256(word))) { return true; }
+        }
+#endif
+#if defined(__SSE4_1__)
+        for (; word + 2 <= words; word += 2) {
+            if (!_mm_testz_si128(load128(word), other.load128(word))) { return true; }
+        }
+#endif
+        for (; word < words; word++) {
+            if ((m_words[word] & other.m_words[word]) != 0) { return true; }
+        }
+        return false;
+    }
+
+    /// @brief Returns the word at the given index.
+    [[nodiscard]] uint64_t word(const size_t index) const { return m_words[index]; }
+
+    /// @brief Replaces the word at the given index.
+    ComponentMask& setWord(const size_t index, const uint64_t word)
+    {
+        m_words[index] = word;
+        return *this;
+    }
+
+    ComponentMask& operator&=(const ComponentMask& other)
+    {
+        for (size_t i = 0; i < WORDS; i++) { m_words[i] &= other.m_words[i]; }
+        return *this;
+    }
+
+    ComponentMask& operator|=(const ComponentMask& other)
+    {
+        for (size_t i = 0; i < WORDS; i++) { m_words[i] |= other.m_words[i]; }
+        return *this;
+    }
+
+    friend ComponentMask operator&(ComponentMask lhs, const ComponentMask& rhs)
+    {
+        return lhs &= rhs;
+    }
+
+    friend ComponentMask operator|(ComponentMask lhs, const ComponentMask& rhs)
+    {
+        return lhs |= rhs;
+    }
+
+    bool operator==(const ComponentMask& other) const = default;
+
+private:
+    std::array<uint64_t, WORDS> m_words{ };
+
+#if defined(__AVX2__)
+    [[nodiscard]] __m256i load256(const size_t word) const
+    {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&m_words[word]));
+    }
+#endif
+
+#if defined(__SSE4_1__)
+    [[nodiscard]] __m128i load128(const size_t word) const
+    {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(&m_words[word]));
+    }
+#endif
+};
+
+} // namespace secs
+
+template <>
+struct std::hash<secs::ComponentMask>
+{
+    size_t operator()(const secs::ComponentMask& mask) const noexcept
+    {
+        size_t seed = 0;
+        for (size_t i = 0; i < secs::ComponentMask::WORDS; i++) {
+            seed ^= std::hash<uint64_t>{ }(mask.word(i)) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        }
+        return seed;
+    }
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "Assert.hpp"
+#include "ComponentMask.hpp"
+#include "Growth.hpp"
+
+
+namespace secs
+{
+
+/**
+ * @brief A list of ComponentMasks stored word-planar: word w of every mask lives in plane w, so the
+ * same word of consecutive masks lies next to each other in memory. A query only reads the planes
+ * of the words its components live in, and can test several masks per SIMD instruction no matter
+ * how wide MAX_COMPONENTS makes a mask.
+ */
+class ComponentMaskPlanes
+{
+public:
+    /// @brief Appends a mask.
+    void pushBack(const ComponentMask& mask)
+    {
+        for (size_t word = 0; word < ComponentMask::WORDS; word++) {
+            m_planes[word].push_back(mask.word(word));
+        }
+    }
+
+    /// @brief Replaces the mask at the given position.
+    void set(const size_t position, const ComponentMask& mask)
+    {
+        for (size_t word = 0; word < ComponentMask::WORDS; word++) {
+            m_planes[word][position] = mask.word(word);
+        }
+    }
+
+    /// @brief Clears the bit at the given index of the mask at the given position.
+    void reset(const size_t position, const size_t index)
+    {
+        SecsAssert(index < MAX_COMPONENTS, "ComponentMask index out of range");
+        m_planes[index / 64][position] &= ~(uint64_t{ 1 } << (index % 64));
+    }
+
+    /// @brief Removes the mask at the given position and fills the hole with the last one.
+    void swapRemove(const size_t position)
+    {
+        for (std::vector<uint64_t>& plane : m_planes) {
+            plane[position] = plane.back();
+            plane.pop_back();
+        }
+    }
+
+    /// @brief Removes all masks.
+    void clear()
+    {
+        for (std::vector<uint64_t>& plane : m_planes) { plane.clear(); }
+    }
+
+    /// @brief Reserves room for capacity masks.
+    void reserve(const size_t capacity)
+    {
+        for (std::vector<uint64_t>& plane : m_planes) { plane.reserve(capacity); }
+    }
+
+    /// @brief Makes room for count more masks, growing geometrically.
+    void reserveMore(const size_t count)
+    {
+        for (std::vector<uint64_t>& plane : m_planes) { secs::reserveMore(plane, count); }
+    }
+
+    /// @brief Releases the unused capacity of all planes.
+    void shrinkToFit()
+    {
+        for (std::vector<uint64_t>& plane : m_planes) { plane.shrink_to_fit(); }
+    }
+
+    [[nodiscard]] size_t size() const { return m_planes[0].size(); }
+
+    /// @brief Checks if the mask at the given position has the bit at the given index set.
+    [[nodiscard]] bool test(const size_t position, const size_t index) const
+    {
+        SecsAssert(index < MAX_COMPONENTS, "ComponentMask index out of range");
+        return (m_planes[index / 64][position] >> (index % 64)) & 1;
+    }
+
+    /// @brief Returns the given word of every mask.
+    [[nodiscard]] std::span<const uint64_t> plane(const size_t word) const
+    {
+        return m_planes[word];
+    }
+
+    /// @brief Gathers the mask at the given position from all planes.
+    ComponentMask operator[](const size_t position) const
+    {
+        ComponentMask mask{ };
+        for (size_t word = 0; word < ComponentMask::WORDS; word++) {
+            mask.setWord(word, m_planes[word][position]);
+        }
+        return mask;
+    }
+
+private:
+    std::array<std::vector<uint64_t>, ComponentMask::WORDS> m_planes{ };
+};
+
+} // namespace secs
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <tuple>
+
+#include "Component.hpp"
+#include "ComponentLayout.hpp"
+#include "EntityHandle.hpp"
+#include "SoAVector.hpp"
+
+
+namespace secs
+{
+
+/**
+ * @brief Raw access to the dense arrays of a ComponentList, obtained through Scene::storage().
+ * Meant for hand written vector kernels that process a whole component type at once: the
+ * components are contiguous, aligned to STORAGE_ALIGNMENT and padded to a multiple of it, and
+ * entities()[i] owns the component at index i.
+ *
+ * Components with a struct of arrays ComponentLayout expose each field as its own array through
+ * field<I>() instead, with the same alignment and padding. Layouts with LANES only expose their
+ * entities. Paged components expose each page as its own array through page(), entities()[i] owns
+ * the component at index i % PAGE_SIZE of page i / PAGE_SIZE.
+ *
+ * Adding or removing components of type T invalidates the arrays. Writes through them are not
+ * tracked by Changed<T>.
+ */
+template <typename T>
+    requires(Component<T>)
+class ComponentStorage
+{
+public:
+    using Dense = typename DenseStorage<T>::Type;
+
+    /// @brief Creates the storage of a component type without components.
+    ComponentStorage() = default;
+
+    ComponentStorage(Dense& components, const std::span<const EntityHandle> entities)
+        : m_components(&components), m_entities(entities) { }
+
+    /// @brief Returns the first component.
+    [[nodiscard]] T* data() const
+        requires(!LayoutComponent<T> && !PagedComponent<T>)
+    {
+        return m_components ? m_components->data() : nullptr;
+    }
+
+    /// @brief Returns all components.
+    [[nodiscard]] std::span<T> span() const
+        requires(!LayoutComponent<T> && !PagedComponent<T>)
+    {
+        return { data(), size() };
+    }
+
+    /// @brief Returns the amount of components rounded up to whole STORAGE_ALIGNMENT blocks, which
+    /// can be read without leaving the array. The values past size() are unspecified.
+    [[nodiscard]] size_t paddedSize() const
+        requires(!LayoutComponent<T> && !PagedComponent<T>)
+    {
+        return m_components ? m_components->paddedSize() : 0;
+    }
+
+    /// @brief Returns the field at index I of all components.
+    template <size_t I>
+        requires(LayoutComponent<T> && layoutLanes<T>() == 0)
+    [[nodiscard]] auto field() const
+    {
+        using Field = std::tuple_element_t<I, FieldTypes<T>>;
+        if (!m_components) { return std::span<Field>{ }; }
+        auto& column = m_components->template column<I>();
+        return std::span<Field>{ column.data(), column.size() };
+    }
+
+    /// @brief Returns the amount of pages holding components.
+    [[nodiscard]] size_t pageCount() const
+        requires(PagedComponent<T>)
+    {
+        return m_components ? m_components->pageCount() : 0;
+    }
+
+    /// @brief Returns the components of the page at the given index. Only the last page may hold
+    /// less than PAGE_SIZE components.
+    [[nodiscard]] std::span<T> page(const size_t page) const
+        requires(PagedComponent<T>)
+    {
+        constexpr size_t PAGE_SIZE = layoutPageSize<T>();
+        const size_t count = std::min(PAGE_SIZE, m_components->size() - page * PAGE_SIZE);
+        return { m_components->page(page), count };
+    }
+
+    /// @brief Returns the entities owning the components, in the same order.
+    [[nodiscard]] std::span<const EntityHandle> entities() const { return m_entities; }
+
+    /// @brief Returns the amount of components.
+    [[nodiscard]] size_t size() const { return m_entities.size(); }
+
+private:
+    /// @brief The dense arrays, nullptr if no component of type T exists yet.
+    Dense* m_components = nullptr;
+    std::span<const EntityHandle> m_entities{ };
+};
+
+} // namespace secs
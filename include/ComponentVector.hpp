@@ -0,0 +1,166 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "Assert.hpp"
+#include "Component.hpp"
+#include "ECSProperties.hpp"
+#include "Growth.hpp"
+
+
+namespace secs
+{
+
+/**
+ * @brief The dense array of components of a ComponentList. Works like a std::vector, but knows
+ * about trivially relocatable components: these are moved around with memcpy, and removing them
+ * runs only the destructor of the removed component, which is skipped entirely for trivially
+ * destructible types. Other types fall back to move construction, just like std::vector.
+ *
+ * The buffer is aligned to STORAGE_ALIGNMENT and its size is padded to a multiple of it, so vector
+ * loads over the components never cross into another allocation.
+ */
+template <typename T>
+class ComponentVector
+{
+public:
+    ComponentVector() = default;
+
+    ~ComponentVector()
+    {
+        clear();
+        deallocate(m_data);
+    }
+
+    ComponentVector(const ComponentVector&)            = delete;
+    ComponentVector& operator=(const ComponentVector&) = delete;
+
+    /// @brief Constructs a component at the back and returns it.
+    template <typename... Args>
+    T& emplaceBack(Args&&... args)
+    {
+        if (m_size == m_capacity) {
+            // args may refer to a component of this vector, so construct before reallocating
+            T component(std::forward<Args>(args)...);
+            reallocate(std::max<size_t>(m_capacity * 2, 8));
+            return *new(m_data + m_size++) T(std::move(component));
+        }
+        return *new(m_data + m_size++) T(std::forward<Args>(args)...);
+    }
+
+    /// @brief Appends count copies of the component at the given index.
+    void appendCopies(const size_t index, const size_t count)
+    {
+        reserve(m_size + count);
+        std::uninitialized_fill_n(m_data + m_size, count, m_data[index]);
+        m_size += count;
+    }
+
+    /// @brief Destroys the component at the given index and fills the hole with the last one.
+    void swapRemove(const size_t index)
+    {
+        const size_t last = m_size - 1;
+        destroy(m_data + index, 1);
+        if (index != last) { relocate(m_data + index, m_data + last, 1); }
+        m_size--;
+    }
+
+    /// @brief Destroys all components, keeping the allocated memory.
+    void clear()
+    {
+        destroy(m_data, m_size);
+        m_size = 0;
+    }
+
+    /// @brief Grows the buffer to hold at least capacity components without reallocating. The
+    /// buffer at least doubles, so growing it in small steps stays amortized O(1) per component.
+    void reserve(const size_t capacity)
+    {
+        if (capacity > m_capacity) { reallocate(grownCapacity(m_capacity, capacity)); }
+    }
+
+    /// @brief Shrinks the buffer to the current amount of components.
+    void shrinkToFit()
+    {
+        if (m_size < m_capacity) { reallocate(m_size); }
+    }
+
+    [[nodiscard]] size_t size() const { return m_size; }
+
+    /// @brief Returns the amount of components rounded up to whole STORAGE_ALIGNMENT blocks, which
+    /// can be read without leaving the buffer. The values past size() are unspecified.
+    [[nodiscard]] size_t paddedSize() const
+    {
+        return m_size == 0 ? 0 : paddedBytes(m_size) / sizeof(T);
+    }
+
+    [[nodiscard]] T* data() { return m_data; }
+    [[nodiscard]] const T* data() const { return m_data; }
+
+    T& operator[](const size_t index) { return m_data[index]; }
+    const T& operator[](const size_t index) const { return m_data[index]; }
+
+    T& back() { return m_data[m_size - 1]; }
+
+private:
+    static constexpr size_t ALIGNMENT = std::max(STORAGE_ALIGNMENT, alignof(T));
+
+    T* m_data         = nullptr;
+    size_t m_size     = 0;
+    size_t m_capacity = 0;
+
+    /// @brief Moves the buffer to one of the given capacity, which must hold all components.
+    void reallocate(const size_t capacity)
+    {
+        T* data = capacity == 0 ? nullptr : allocate(capacity);
+        relocate(data, m_data, m_size);
+        deallocate(m_data);
+        m_data     = data;
+        m_capacity = capacity;
+    }
+
+    /// @brief Moves count components from src into the uninitialized memory at dst, ending the
+    /// lifetime of the components at src.
+    static void relocate(T* dst, T* src, const size_t count)
+    {
+        if (count == 0) { return; }
+
+        if constexpr (isTriviallyRelocatable<T>) {
+            std::memcpy(static_cast<void*>(dst), static_cast<const void*>(src), count * sizeof(T));
+        } else {
+            std::uninitialized_move_n(src, count, dst);
+            std::destroy_n(src, count);
+        }
+    }
+
+    static void destroy(T* components, const size_t count)
+    {
+        if constexpr (!std::is_trivially_destructible_v<T>) { std::destroy_n(components, count); }
+    }
+
+    /// @brief Returns the size in bytes of count components rounded up to STORAGE_ALIGNMENT.
+    static size_t paddedBytes(const size_t count)
+    {
+        return (count * sizeof(T) + STORAGE_ALIGNMENT - 1) / STORAGE_ALIGNMENT * STORAGE_ALIGNMENT;
+    }
+
+    static T* allocate(const size_t capacity)
+    {
+        return static_cast<T*>(
+            ::operator new(paddedBytes(capacity), std::align_val_t{ ALIGNMENT })
+        );
+    }
+
+    static void deallocate(T* data)
+    {
+        if (data) { ::operator delete(data, std::align_val_t{ ALIGNMENT }); }
+    }
+};
+
+} // namespace secs
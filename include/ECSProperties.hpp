@@ -1,6 +1,72 @@
 #pragma once
 
+#include <cstddef>
+
 // TODO: this should probably be put into a Properties config struct we pass to scene on creation
 
+#ifndef SECS_MAX_COMPONENTS
+/// @brief The max amount of components a Scene can handle, i.e. the width of a ComponentMask. Can
+/// be raised by defining it before including secs, e.g. through the CMake cache variable.
+#define SECS_MAX_COMPONENTS 64
+#endif
+
 /// @brief The max amount of components a Scene can handle.
-constexpr int MAX_COMPONENTS = 32;
+constexpr int MAX_COMPONENTS = SECS_MAX_COMPONENTS;
+static_assert(
+    MAX_COMPONENTS > 0 && MAX_COMPONENTS % 64 == 0,
+    "SECS_MAX_COMPONENTS must be a multiple of 64"
+);
+
+/// @brief The size in bytes of a single archetype chunk. Entities of the same archetype are packed
+/// into chunks of this size, with one column per component type.
+constexpr size_t CHUNK_SIZE = 16 * 1024;
+
+/// @brief The alignment of the dense component arrays of ComponentLists, whose sizes are padded to a
+/// multiple of it as well. Covers a cache line and the widest vector registers.
+constexpr size_t STORAGE_ALIGNMENT = 64;
+
+/// @brief The default amount of entities a single job of Scene::parEach() processes.
+constexpr size_t PAR_EACH_GRAIN_SIZE = 1024;
+
+namespace secs
+{
+
+/**
+ * @brief Defines how a Scene stores the components of its entities.
+ */
+enum StorageMode
+{
+    /// Every component type lives in its own ComponentList.
+    LIST_STORAGE,
+    /// Entities with the same ComponentMask are stored together in chunks, one column per component.
+    ARCHETYPE_STORAGE,
+};
+
+/**
+ * @brief Defines how a Scene answers queries that are not cached by a view.
+ */
+enum QueryEngine
+{
+    /// The ComponentMask of every alive entity is tested against the query.
+    MASK_QUERY_ENGINE,
+    /// Every component type keeps a bitset of the entity indices having it, and queries combine
+    /// these word by word. Costs a little on every component change, but is much faster for
+    /// queries matching few entities.
+    BITSET_QUERY_ENGINE,
+};
+
+/**
+ * @brief Configuration that is passed to a Scene on creation.
+ */
+struct SceneProperties
+{
+    StorageMode storage = LIST_STORAGE;
+    /// @brief The amount of worker threads of the JobSystem. If negative, one worker per hardware
+    /// thread minus the calling thread is used.
+    int workerCount = -1;
+    /// @brief Pins each worker thread to its own CPU core. Only supported on Linux.
+    bool pinWorkers = false;
+    QueryEngine queryEngine = MASK_QUERY_ENGINE;
+};
+
+} // namespace secs
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "EntityHandle.hpp"
+
+
+namespace secs
+{
+
+/**
+ * @brief A growable set of entity indices, one bit per index. On top of the bit words sits a
+ * summary with one bit per word, which is set if the word holds any bit. Walking the summary skips
+ * 4096 empty indices per zero summary word, so sparse sets are iterated without touching their
+ * empty regions.
+ */
+class EntityBitset
+{
+public:
+    /// @brief Adds the index to the set.
+    void set(const EntityIndex index)
+    {
+        const size_t word = index / 64;
+        if (word >= m_words.size()) {
+            m_words.resize(word + 1);
+            m_summary.resize(word / 64 + 1);
+        }
+        m_words[word] |= bit(index);
+        m_summary[word / 64] |= bit(word);
+    }
+
+    /// @brief Removes the index from the set.
+    void reset(const EntityIndex index)
+    {
+        const size_t word = index / 64;
+        if (word >= m_words.size()) { return; }
+
+        m_words[word] &= ~bit(index);
+        if (m_words[word] == 0) { m_summary[word / 64] &= ~bit(word); }
+    }
+
+    /// @brief Checks if the index is part of the set.
+    [[nodiscard]] bool test(const EntityIndex index) const
+    {
+        return (word(index / 64) & bit(index)) != 0;
+    }
+
+    /// @brief Removes all indices, keeping the allocated words.
+    void clear()
+    {
+        std::ranges::fill(m_words, 0);
+        std::ranges::fill(m_summary, 0);
+    }
+
+    /// @brief Returns the word holding the indices [index * 64, index * 64 + 64).
+    [[nodiscard]] uint64_t word(const size_t index) const
+    {
+        return index < m_words.size() ? m_words[index] : 0;
+    }
+
+    /// @brief Returns the summary word of the words [index * 64, index * 64 + 64).
+    [[nodiscard]] uint64_t summaryWord(const size_t index) const
+    {
+        return index < m_summary.size() ? m_summary[index] : 0;
+    }
+
+    /// @brief Returns the amount of summary words, beyond which the set is empty.
+    [[nodiscard]] size_t summarySize() const { return m_summary.size(); }
+
+    /// @brief Reserves room for the indices [0, indexCount), so setting them does not allocate.
+    void reserve(const size_t indexCount)
+    {
+        const size_t words = (indexCount + 63) / 64;
+        m_words.reserve(words);
+        m_summary.reserve((words + 63) / 64);
+    }
+
+    /// @brief Returns the amount of indices the set can hold without allocating.
+    [[nodiscard]] size_t capacity() const { return m_words.capacity() * 64; }
+
+    /// @brief Releases the capacity not needed for the current words.
+    void shrinkToFit()
+    {
+        m_words.shrink_to_fit();
+        m_summary.shrink_to_fit();
+    }
+
+private:
+    std::vector<uint64_t> m_words{ };
+    /// @brief Bit i of summary word j is set if word j * 64 + i is not zero.
+    std::vector<uint64_t> m_summary{ };
+
+    static uint64_t bit(const size_t index) { return uint64_t{ 1 } << (index % 64); }
+};
+
+} // namespace secs
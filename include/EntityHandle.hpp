@@ -1,4 +1,7 @@
 #pragma once
+#include <chrono>
+#include <cstdint>
+#include <format>
 #include <random>
 
 
@@ -6,7 +9,8 @@ namespace secs
 {
 
 /**
- * @brief A randomly assigned 64-bit integer ID.
+ * @brief A randomly assigned 64-bit integer ID. Should only be used where an ID has to stay stable
+ * outside of a running Scene, for example when serializing. Entities use the EntityHandle.
  */
 class Handle
 {
@@ -64,8 +68,59 @@ private:
 };
 
 
-/// @brief A Handle representing an entity
-using EntityHandle = Handle;
+/// @brief A dense index assigned to each alive entity. Indices of destroyed entities are reused.
+using EntityIndex                          = uint32_t;
+constexpr EntityIndex INVALID_ENTITY_INDEX = UINT32_MAX;
+
+/// @brief Counts how often an EntityIndex has been reused. 0 is never a valid generation.
+using EntityGeneration = uint32_t;
+
+/**
+ * @brief A handle representing an entity. Consists of a dense EntityIndex in the lower 32 bits and
+ * the generation of that index in the upper 32 bits. Once an entity is destroyed the generation of
+ * its index is incremented, so stale handles can be detected with a single compare.
+ */
+class EntityHandle
+{
+public:
+    EntityHandle()                               = default;
+    EntityHandle(const EntityHandle&)            = default;
+    EntityHandle& operator=(const EntityHandle&) = default;
+
+    /// Constructs a handle from an index and its generation
+    EntityHandle(const EntityIndex index, const EntityGeneration generation)
+        : m_handle(static_cast<uint64_t>(generation) << 32 | index) { }
+
+    /// Constructs and returns an invalid handle
+    static EntityHandle invalid()
+    {
+        return EntityHandle{ };
+    }
+
+    /// Invalidates this handle
+    void invalidate()
+    {
+        m_handle = 0;
+    }
+
+    /// Returns the dense index of this entity
+    EntityIndex index() const { return static_cast<EntityIndex>(m_handle); }
+
+    /// Returns the generation of this entity's index
+    EntityGeneration generation() const { return static_cast<EntityGeneration>(m_handle >> 32); }
+
+    /// Returns the underlying packed value
+    uint64_t id() const { return m_handle; }
+
+    bool operator==(const EntityHandle& other) const { return m_handle == other.m_handle; }
+    bool operator<(const EntityHandle& other) const { return m_handle < other.m_handle; }
+
+    explicit operator bool() const { return m_handle != 0; }
+    explicit operator uint64_t() const { return m_handle; }
+
+private:
+    uint64_t m_handle = 0;
+};
 
 } // namespace siren::ecs
 // Hash support
@@ -78,6 +133,15 @@ struct std::hash<secs::Handle>
     }
 };
 
+template <>
+struct std::hash<secs::EntityHandle>
+{
+    size_t operator()(const secs::EntityHandle& handle) const noexcept
+    {
+        return std::hash<uint64_t>{}(handle.id());
+    }
+};
+
 // std::formatter support
 template <>
 struct std::formatter<secs::Handle> : std::formatter<uint64_t>
@@ -86,4 +150,13 @@ struct std::formatter<secs::Handle> : std::formatter<uint64_t>
     {
         return std::formatter<uint64_t>::format(handle.m_handle, ctx);
     }
-};
\ No newline at end of file
+};
+
+template <>
+struct std::formatter<secs::EntityHandle> : std::formatter<uint64_t>
+{
+    auto format(const secs::EntityHandle& handle, std::format_context& ctx) const
+    {
+        return std::formatter<uint64_t>::format(handle.id(), ctx);
+    }
+};
@@ -1,21 +1,30 @@
 #pragma once
 
-#include <bitset>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "ComponentBitMap.hpp"
+#include "ComponentMask.hpp"
+#include "ComponentMaskPlanes.hpp"
 #include "ECSProperties.hpp"
+#include "EntityBitset.hpp"
 #include "EntityHandle.hpp"
+#include "Growth.hpp"
+#include "Query.hpp"
+#include "View.hpp"
 
 
 namespace secs
 {
 
-
-
-
-
 /**
  * @brief Responsible for the creation, destruction and invalidation of EntityHandle's, as well as
  * managing the ComponentMask of each entity.
@@ -24,82 +33,388 @@ class EntityManager
 {
 public:
     /// @brief A bitmask used to indicate what components an entity has assigned.
-    using ComponentMask = std::bitset<MAX_COMPONENTS>;
+    using ComponentMask = secs::ComponentMask;
+
+    EntityManager() = default;
+
+    /// @brief Creates an EntityManager answering getWith() with the given engine.
+    explicit EntityManager(const QueryEngine queryEngine) : m_queryEngine(queryEngine) { }
 
-    /// @brief Creates a new entity.
-    EntityHandle create()
+    /// @brief Creates a new entity with the given mask. Reuses the index of a previously destroyed
+    /// entity if possible.
+    EntityHandle create(const ComponentMask& mask = ComponentMask{ })
     {
-        const EntityHandle e = EntityHandle::create();
+        EntityIndex index;
+        if (!m_freeIndices.empty()) {
+            index = m_freeIndices.back();
+            m_freeIndices.pop_back();
+        } else {
+            index = static_cast<EntityIndex>(m_generations.size());
+            SecsAssert(index != INVALID_ENTITY_INDEX, "Ran out of entity indices");
+            m_generations.push_back(1);
+            m_indexToAlive.emplace_back();
+        }
 
-        SecsAssert(e, "Created invalid entity (idk how).");
-        SecsAssert(!m_entityToMask.contains(e), "Created already existing entity");
-        SecsAssert(!m_entityToIndex.contains(e), "Created already existing entity");
+        const EntityHandle e{ index, m_generations[index] };
 
-        m_entityToMask[e] = ComponentMask{ };
+        m_indexToAlive[index] = m_alive.size();
         m_alive.push_back(e);
-        m_entityToIndex[e] = m_alive.size() - 1;
+        m_aliveMasks.pushBack(mask);
+        if (m_queryEngine == BITSET_QUERY_ENGINE) { m_aliveBits.set(index); }
+        updateBitsets(index, ComponentMask{ }, mask);
+
+        for (const auto& view : m_views) {
+            if (view->matches(mask)) { view->insert(e); }
+        }
 
         return e;
     }
 
-    /// @brief Invalidates the entity and erases its mask.
+    /// @brief Creates count new entities with the given mask. The tables grow geometrically, so
+    /// creating entities in many small batches is as cheap as creating them one by one.
+    std::vector<EntityHandle> createMany(const size_t count, const ComponentMask& mask)
+    {
+        const size_t fresh = count > m_freeIndices.size() ? count - m_freeIndices.size() : 0;
+        reserveMore(m_generations, fresh);
+        reserveMore(m_indexToAlive, fresh);
+        reserveMore(m_alive, count);
+        m_aliveMasks.reserveMore(count);
+
+        std::vector<EntityHandle> entities{ };
+        entities.reserve(count);
+        for (size_t i = 0; i < count; i++) { entities.push_back(create(mask)); }
+        return entities;
+    }
+
+    /// @brief Invalidates the entity and erases its mask. Its index will be reused by a future
+    /// entity with the next generation.
     void destroy(EntityHandle entity)
     {
-        if (!entity) { return; }
+        if (!isAlive(entity)) { return; }
+        removeAlive(release(entity));
+        entity.invalidate();
+    }
 
-        m_alive[m_entityToIndex[entity]]                  = m_alive.back();
-        m_entityToIndex[m_alive[m_entityToIndex[entity]]] = m_entityToIndex[entity];
+    /// @brief Destroys all given entities. All entities are released first, then their positions in
+    /// the alive list are freed from the highest down, so each hole is filled by an entity that
+    /// stays and the alive list and its masks are compacted in a single pass.
+    void destroyMany(const std::span<const EntityHandle> entities)
+    {
+        // reused across calls, per thread as separate scenes may be used from different threads
+        static thread_local std::vector<size_t> positions{ };
+        positions.clear();
+        for (const EntityHandle entity : entities) {
+            if (isAlive(entity)) { positions.push_back(release(entity)); }
+        }
 
-        m_alive.pop_back();
+        std::ranges::sort(positions, std::greater{ });
+        for (const size_t position : positions) { removeAlive(position); }
+    }
 
-        m_entityToIndex.erase(entity);
-        m_entityToMask.erase(entity);
-        entity.invalidate();
+    /// @brief Destroys all entities at once. Instead of removing entities one by one, the alive
+    /// list, its masks and all views are truncated wholesale.
+    void destroyAll()
+    {
+        for (const EntityHandle entity : m_alive) {
+            const EntityIndex index = entity.index();
+            if (++m_generations[index] == 0) { m_generations[index] = 1; }
+            m_freeIndices.push_back(index);
+        }
+        m_alive.clear();
+        m_aliveMasks.clear();
+        for (const auto& view : m_views) { view->clear(); }
+        if (m_queryEngine == BITSET_QUERY_ENGINE) {
+            m_aliveBits.clear();
+            for (EntityBitset& bitset : m_componentBits) { bitset.clear(); }
+        }
     }
 
+    /// @brief Checks if the entity exists and has not been destroyed yet.
+    [[nodiscard]] bool isAlive(const EntityHandle entity) const
+    {
+        const EntityIndex index = entity.index();
+        return entity && index < m_generations.size() && m_generations[index] == entity.generation();
+    }
 
-    /// @brief Returns all entities that have the component bits set in the mask
-    std::vector<EntityHandle> getWith(ComponentMask components) const
+    /// @brief Returns all entities whose mask matches the query
+    std::vector<EntityHandle> getWith(const QueryMask& query) const
     {
-        // This is probably the best solution with the current setup, but might have to rework whole ecs
-        // if things start slowing down
         std::vector<EntityHandle> entities{ };
-        for (const auto& [handle, mask] : m_entityToMask) {
-            if ((mask & components) == components) { entities.push_back(handle); }
-        }
+        getWith(query, entities);
         return entities;
     }
 
+    /// @brief Appends all entities whose mask matches the query to entities. The masks of the alive
+    /// entities are scanned linearly, collecting the matching positions in a buffer that is reused
+    /// across calls, so passing the same vector each time does not allocate either.
+    void getWith(const QueryMask& query, std::vector<EntityHandle>& entities) const
+    {
+        if (m_queryEngine == BITSET_QUERY_ENGINE) {
+            getWithBitsets(query, entities);
+            return;
+        }
+
+        // per thread, as systems running concurrently may query at the same time
+        static thread_local std::vector<uint32_t> matches{ };
+        matches.clear();
+        query.scan(m_aliveMasks, matches);
+
+        entities.reserve(entities.size() + matches.size());
+        for (const uint32_t position : matches) { entities.push_back(m_alive[position]); }
+    }
+
     /// @brief Returns all entities
     std::vector<EntityHandle> getAll() const
     {
         return m_alive;
     }
 
-    /// @brief Updates the given entities bitmask to correspond with its new component type.
-    template <typename T>
+    /// @brief Returns all entities without copying them.
+    [[nodiscard]] std::span<const EntityHandle> alive() const
+    {
+        return m_alive;
+    }
+
+    /// @brief Returns the ComponentMask of an alive entity.
+    [[nodiscard]] ComponentMask getMask(const EntityHandle entity) const
+    {
+        return m_aliveMasks[m_indexToAlive[entity.index()]];
+    }
+
+    /// @brief Checks if the mask of an alive entity has the bit at the given index set, without
+    /// gathering the whole mask.
+    [[nodiscard]] bool hasBit(const EntityHandle entity, const size_t index) const
+    {
+        return m_aliveMasks.test(m_indexToAlive[entity.index()], index);
+    }
+
+    /// @brief Updates the given entities bitmask to correspond with its new component types.
+    template <typename... Ts>
     void add(const EntityHandle entity)
     {
-        if (!entity) { return; }
-        if (!m_entityToMask.contains(entity)) { return; }
+        if (!isAlive(entity)) { return; }
 
-        m_entityToMask[entity].set(ComponentBitMap::getBitIndex<T>());
+        ComponentMask mask = getMask(entity);
+        (mask.set(ComponentBitMap::getBitIndex<Ts>()), ...);
+        setMask(entity, mask);
     }
 
     /// @brief Removes the given entities bitmask corresponding with the component type.
     template <typename T>
-    void remove(EntityHandle& entity)
+    void remove(const EntityHandle entity)
+    {
+        if (!isAlive(entity)) { return; }
+
+        ComponentMask mask = getMask(entity);
+        setMask(entity, mask.reset(ComponentBitMap::getBitIndex<T>()));
+    }
+
+    /// @brief Removes the bit of component type T from the masks of the given entities, which must
+    /// be all entities having T. The bit is cleared in place in its plane, the masks are only
+    /// gathered if views have to be updated, and the bitset of T is cleared as a whole.
+    template <typename T>
+    void clear(const std::span<const EntityHandle> entities)
+    {
+        const size_t componentIndex = ComponentBitMap::getBitIndex<T>();
+        for (const EntityHandle entity : entities) {
+            const size_t alivePosition = m_indexToAlive[entity.index()];
+            if (!m_views.empty()) {
+                const ComponentMask before = m_aliveMasks[alivePosition];
+                const ComponentMask after  = ComponentMask{ before }.reset(componentIndex);
+                for (const auto& view : m_views) { view->update(entity, before, after); }
+            }
+            m_aliveMasks.reset(alivePosition, componentIndex);
+        }
+        if (m_queryEngine == BITSET_QUERY_ENGINE) { m_componentBits[componentIndex].clear(); }
+    }
+
+    /// @brief Reserves room for the given amount of entities in all tables, including the views and
+    /// the bitsets of the BITSET_QUERY_ENGINE.
+    void reserve(const size_t entityCount)
+    {
+        m_generations.reserve(entityCount);
+        m_indexToAlive.reserve(entityCount);
+        m_freeIndices.reserve(entityCount);
+        m_alive.reserve(entityCount);
+        m_aliveMasks.reserve(entityCount);
+        for (const auto& view : m_views) { view->reserve(entityCount); }
+        if (m_queryEngine == BITSET_QUERY_ENGINE) {
+            m_aliveBits.reserve(entityCount);
+            for (EntityBitset& bitset : m_componentBits) { bitset.reserve(entityCount); }
+        }
+    }
+
+    /// @brief Releases unused capacity. The tables indexed by entity index can only shrink down to
+    /// the highest index ever handed out, as indices stay reserved for their generation.
+    void shrinkToFit()
     {
-        if (!entity) { return; }
-        if (!m_entityToMask.contains(entity)) { return; }
+        m_generations.shrink_to_fit();
+        m_indexToAlive.shrink_to_fit();
+        m_freeIndices.shrink_to_fit();
+        m_alive.shrink_to_fit();
+        m_aliveMasks.shrinkToFit();
+        for (const auto& view : m_views) { view->shrinkToFit(); }
+        m_aliveBits.shrinkToFit();
+        for (EntityBitset& bitset : m_componentBits) { bitset.shrinkToFit(); }
+    }
 
-        m_entityToMask[entity].reset(ComponentBitMap::getBitIndex<T>());
+    /// @brief Returns the view of all entities matching the query. The view is created and filled
+    /// on first use, and kept up to date from then on.
+    const ViewStorage& getCreateView(const QueryMask& query)
+    {
+        auto& view = m_queryToView[query];
+        if (!view) {
+            m_views.push_back(std::make_unique<ViewStorage>(query));
+            view = m_views.back().get();
+            std::vector<EntityHandle> entities{ };
+            getWith(query, entities);
+            for (const EntityHandle entity : entities) { view->insert(entity); }
+        }
+        return *view;
     }
 
 private:
-    std::unordered_map<EntityHandle, ComponentMask> m_entityToMask{ };
-    std::unordered_map<EntityHandle, size_t> m_entityToIndex{ };
+    /// @brief The current generation of each entity index.
+    std::vector<EntityGeneration> m_generations{ };
+    /// @brief Position of each entity index inside m_alive.
+    std::vector<size_t> m_indexToAlive{ };
+    /// @brief Indices of destroyed entities, ready to be reused.
+    std::vector<EntityIndex> m_freeIndices{ };
     std::vector<EntityHandle> m_alive{ };
+    /// @brief The ComponentMask of each entity in m_alive, at the same position. Kept dense and
+    /// word-planar so queries scan only the words they need, linearly.
+    ComponentMaskPlanes m_aliveMasks{ };
+
+    QueryEngine m_queryEngine = MASK_QUERY_ENGINE;
+    /// @brief The indices of all alive entities. Only maintained by the BITSET_QUERY_ENGINE.
+    EntityBitset m_aliveBits{ };
+    /// @brief The indices of the entities having each component type, by bit index. Only
+    /// maintained by the BITSET_QUERY_ENGINE.
+    std::array<EntityBitset, MAX_COMPONENTS> m_componentBits{ };
+
+    /// @brief All registered views, updated on every mask change.
+    std::vector<std::unique_ptr<ViewStorage>> m_views{ };
+    /// @brief Mapping of a views query to the view, so each query is only registered once.
+    std::unordered_map<QueryMask, ViewStorage*> m_queryToView{ };
+
+    /// @brief Invalidates an alive entity and removes it from all views and bitsets, returning its
+    /// position in m_alive. The position itself is freed by removeAlive().
+    size_t release(const EntityHandle entity)
+    {
+        const EntityIndex index    = entity.index();
+        const size_t alivePosition = m_indexToAlive[index];
+        const ComponentMask mask   = m_aliveMasks[alivePosition];
+        for (const auto& view : m_views) {
+            if (view->matches(mask)) { view->erase(entity); }
+        }
+        updateBitsets(index, mask, ComponentMask{ });
+        if (m_queryEngine == BITSET_QUERY_ENGINE) { m_aliveBits.reset(index); }
+
+        // 0 is never a valid generation, so skip it on wrap around
+        if (++m_generations[index] == 0) { m_generations[index] = 1; }
+        m_freeIndices.push_back(index);
+        return alivePosition;
+    }
+
+    /// @brief Removes the given position from m_alive and its mask by moving the last alive entity
+    /// into it.
+    void removeAlive(const size_t alivePosition)
+    {
+        const EntityHandle last = m_alive.back();
+
+        m_alive[alivePosition]       = last;
+        m_indexToAlive[last.index()] = alivePosition;
+        m_alive.pop_back();
+        m_aliveMasks.swapRemove(alivePosition);
+    }
+
+    /// @brief Replaces the mask of an alive entity and updates all views.
+    void setMask(const EntityHandle entity, const ComponentMask& mask)
+    {
+        const size_t alivePosition  = m_indexToAlive[entity.index()];
+        const ComponentMask current = m_aliveMasks[alivePosition];
+        if (current == mask) { return; }
+
+        for (const auto& view : m_views) { view->update(entity, current, mask); }
+        updateBitsets(entity.index(), current, mask);
+        m_aliveMasks.set(alivePosition, mask);
+    }
+
+    /// @brief Updates the component bitsets of an entity index whose mask changes from before to
+    /// after.
+    void updateBitsets(
+        const EntityIndex index,
+        const ComponentMask& before,
+        const ComponentMask& after
+    )
+    {
+        if (m_queryEngine != BITSET_QUERY_ENGINE) { return; }
+
+        for (size_t word = 0; word < ComponentMask::WORDS; word++) {
+            uint64_t changed = before.word(word) ^ after.word(word);
+            while (changed != 0) {
+                const size_t bit = word * 64 + std::countr_zero(changed);
+                if (after.test(bit)) {
+                    m_componentBits[bit].set(index);
+                } else {
+                    m_componentBits[bit].reset(index);
+                }
+                changed &= changed - 1;
+            }
+        }
+    }
+
+    /// @brief Answers getWith() by combining the bitsets of the queried components word by word.
+    /// Only the summary words set in every required bitset are visited, so regions without any
+    /// candidate are skipped 4096 entities at a time. The entities are appended in index order.
+    void getWithBitsets(const QueryMask& query, std::vector<EntityHandle>& entities) const
+    {
+        // the bitsets to combine, by how the query uses them. Reused across calls, per thread as
+        // systems running concurrently may query at the same time
+        static thread_local std::vector<const EntityBitset*> all{ };
+        static thread_local std::vector<const EntityBitset*> none{ };
+        static thread_local std::vector<const EntityBitset*> any{ };
+        all.clear();
+        none.clear();
+        any.clear();
+
+        for (size_t bit = 0; bit < query.words * 64; bit++) {
+            if (query.all.test(bit)) { all.push_back(&m_componentBits[bit]); }
+            if (query.none.test(bit)) { none.push_back(&m_componentBits[bit]); }
+            if (query.any.test(bit)) { any.push_back(&m_componentBits[bit]); }
+        }
+        if (all.empty()) { all.push_back(&m_aliveBits); }
+
+        size_t summarySize = all.front()->summarySize();
+        for (const EntityBitset* bitset : all) {
+            summarySize = std::min(summarySize, bitset->summarySize());
+        }
+
+        for (size_t summaryIndex = 0; summaryIndex < summarySize; summaryIndex++) {
+            uint64_t summary = ~uint64_t{ 0 };
+            for (const EntityBitset* bitset : all) { summary &= bitset->summaryWord(summaryIndex); }
+
+            while (summary != 0) {
+                const size_t wordIndex = summaryIndex * 64 + std::countr_zero(summary);
+                summary &= summary - 1;
+
+                uint64_t word = ~uint64_t{ 0 };
+                for (const EntityBitset* bitset : all) { word &= bitset->word(wordIndex); }
+                for (const EntityBitset* bitset : none) { word &= ~bitset->word(wordIndex); }
+                if (!any.empty()) {
+                    uint64_t anyWord = 0;
+                    for (const EntityBitset* bitset : any) { anyWord |= bitset->word(wordIndex); }
+                    word &= anyWord;
+                }
+
+                while (word != 0) {
+                    const size_t index = wordIndex * 64 + std::countr_zero(word);
+                    entities.emplace_back(static_cast<EntityIndex>(index), m_generations[index]);
+                    word &= word - 1;
+                }
+            }
+        }
+    }
 };
 
 } // namespace siren::ecs
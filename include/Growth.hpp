@@ -0,0 +1,27 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+
+namespace secs
+{
+
+/// @brief Returns the capacity a buffer of the given capacity grows to so it holds required
+/// elements. The capacity at least doubles, so growing one element at a time stays amortized O(1)
+/// per element instead of reallocating on every call.
+constexpr size_t grownCapacity(const size_t capacity, const size_t required)
+{
+    if (required <= capacity) { return capacity; }
+    return std::max(required, capacity * 2);
+}
+
+/// @brief Makes room for count more elements at the back of vector, growing it geometrically.
+template <typename T>
+void reserveMore(std::vector<T>& vector, const size_t count)
+{
+    vector.reserve(grownCapacity(vector.capacity(), vector.size() + count));
+}
+
+} // namespace secs
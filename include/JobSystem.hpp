@@ -0,0 +1,276 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+
+namespace secs
+{
+
+/**
+ * @brief A work stealing job system. Every worker owns a deque of jobs which it pushes to and pops
+ * from at the back, while idle workers steal from the front of the others. Work is submitted fork/
+ * join style through run() and parallelFor(), which return once all their jobs are done. The
+ * waiting thread executes jobs itself instead of blocking, so both can be nested freely, e.g. a
+ * system running as a job may split its own entity loop into more jobs.
+ */
+class JobSystem
+{
+public:
+    /// @brief Creates a job system with the given amount of worker threads, or one per hardware
+    /// thread minus the calling thread if workerCount is negative. If pinWorkers is set, each
+    /// worker is pinned to its own CPU core (only supported on Linux). Threads are started on first
+    /// use.
+    explicit JobSystem(const int workerCount = -1, const bool pinWorkers = false)
+        : m_workerCount(workerCount < 0 ? defaultWorkerCount() : static_cast<size_t>(workerCount)),
+          m_pinWorkers(pinWorkers)
+    {
+        // queue 0 is shared by all threads that are not workers of this job system
+        m_queues = std::make_unique<Queue[]>(m_workerCount + 1);
+    }
+
+    ~JobSystem()
+    {
+        {
+            std::lock_guard lock{ m_sleepMutex };
+            m_stopping = true;
+        }
+        m_wake.notify_all();
+        for (auto& worker : m_workers) { worker.join(); }
+    }
+
+    JobSystem(const JobSystem&)            = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    /// @brief Calls fn(i) for every i in [0, count) as separate jobs and returns once all calls
+    /// have finished.
+    template <typename Fn>
+    void run(const size_t count, Fn&& fn)
+    {
+        parallelFor(count, 1, [&fn](const size_t begin, const size_t end) {
+            for (size_t i = begin; i < end; i++) { fn(i); }
+        });
+    }
+
+    /// @brief Calls fn(begin, end) for consecutive ranges covering [0, count) that are at most
+    /// grain long, and returns once all calls have finished. Ranges are split in halves on demand,
+    /// so idle workers steal the largest remaining ranges first.
+    template <typename Fn>
+    void parallelFor(const size_t count, const size_t grain, Fn&& fn)
+    {
+        if (count == 0) { return; }
+        const size_t grainSize = std::max<size_t>(grain, 1);
+        if (count <= grainSize || m_workerCount == 0) {
+            fn(size_t{ 0 }, count);
+            return;
+        }
+
+        start();
+        std::atomic<size_t> pending{ 1 };
+        void* context = const_cast<void*>(static_cast<const void*>(std::addressof(fn)));
+        execute(Job{ &call<std::remove_reference_t<Fn>>, context, 0, count, grainSize, &pending });
+        wait(pending);
+    }
+
+    /// @brief Returns the amount of worker threads, not counting the calling thread.
+    [[nodiscard]] size_t workerCount() const
+    {
+        return m_workerCount;
+    }
+
+    /// @brief Returns the index of the calling thread in [0, workerCount()]. Workers of this job
+    /// system have indices starting at 1, every other thread has index 0.
+    [[nodiscard]] size_t threadIndex() const
+    {
+        return ownQueue();
+    }
+
+    /// @brief Returns one worker per hardware thread, minus the calling thread.
+    static size_t defaultWorkerCount()
+    {
+        return std::max(std::thread::hardware_concurrency(), 1u) - 1;
+    }
+
+private:
+    /// @brief A range of a parallelFor() call. Only points to the callable, which lives on the
+    /// stack of the waiting caller.
+    struct Job
+    {
+        void (*fn)(void* context, size_t begin, size_t end);
+        void* context;
+        size_t begin;
+        size_t end;
+        size_t grain;
+        std::atomic<size_t>* pending;
+    };
+
+    /// @brief How often an idle worker checks for new jobs before going to sleep.
+    static constexpr size_t SPIN_COUNT = 64;
+
+    struct alignas(64) Queue
+    {
+        std::mutex mutex{ };
+        std::deque<Job> jobs{ };
+    };
+
+    size_t m_workerCount = 0;
+    bool m_pinWorkers    = false;
+    std::unique_ptr<Queue[]> m_queues{ };
+    std::vector<std::thread> m_workers{ };
+    std::once_flag m_started{ };
+
+    /// @brief The amount of jobs in all queues, lets idle workers decide whether to sleep.
+    std::atomic<size_t> m_queued{ 0 };
+    std::atomic<size_t> m_sleeping{ 0 };
+    std::mutex m_sleepMutex{ };
+    std::condition_variable m_wake{ };
+    bool m_stopping = false;
+
+    /// @brief The job system the current thread is a worker of, and the index of its queue.
+    static inline thread_local const JobSystem* s_owner = nullptr;
+    static inline thread_local size_t s_queueIndex      = 0;
+
+    template <typename Fn>
+    static void call(void* context, const size_t begin, const size_t end)
+    {
+        (*static_cast<Fn*>(context))(begin, end);
+    }
+
+    void start()
+    {
+        std::call_once(m_started, [this] {
+            m_workers.reserve(m_workerCount);
+            for (size_t i = 1; i <= m_workerCount; i++) {
+                m_workers.emplace_back([this, i] { work(i); });
+            }
+        });
+    }
+
+    [[nodiscard]] size_t ownQueue() const
+    {
+        return s_owner == this ? s_queueIndex : 0;
+    }
+
+    void push(const Job& job)
+    {
+        Queue& queue = m_queues[ownQueue()];
+        {
+            std::lock_guard lock{ queue.mutex };
+            queue.jobs.push_back(job);
+        }
+        m_queued.fetch_add(1);
+
+        // taking the lock makes sure a worker about to sleep either sees the job or gets notified
+        if (m_sleeping.load() > 0) {
+            { std::lock_guard lock{ m_sleepMutex }; }
+            m_wake.notify_one();
+        }
+    }
+
+    /// @brief Pops the newest job of the own queue, or steals the oldest job of another queue.
+    bool pop(Job& job)
+    {
+        const size_t own = ownQueue();
+        for (size_t i = 0; i <= m_workerCount; i++) {
+            const size_t index = (own + i) % (m_workerCount + 1);
+            Queue& queue       = m_queues[index];
+
+            std::lock_guard lock{ queue.mutex };
+            if (queue.jobs.empty()) { continue; }
+            if (index == own) {
+                job = queue.jobs.back();
+                queue.jobs.pop_back();
+            } else {
+                job = queue.jobs.front();
+                queue.jobs.pop_front();
+            }
+            m_queued.fetch_sub(1);
+            return true;
+        }
+        return false;
+    }
+
+    /// @brief Splits off the upper half of the job until it is at most grain long, so the halves
+    /// can be stolen, and then runs the rest.
+    void execute(Job job)
+    {
+        while (job.end - job.begin > job.grain) {
+            const size_t middle = job.begin + (job.end - job.begin) / 2;
+            Job upper           = job;
+            upper.begin         = middle;
+            job.end             = middle;
+            job.pending->fetch_add(1, std::memory_order_relaxed);
+            push(upper);
+        }
+        job.fn(job.context, job.begin, job.end);
+        job.pending->fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    /// @brief Executes jobs until all jobs counted by pending have finished.
+    void wait(const std::atomic<size_t>& pending)
+    {
+        while (pending.load(std::memory_order_acquire) != 0) {
+            Job job{ };
+            if (pop(job)) {
+                execute(job);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void work(const size_t queueIndex)
+    {
+        s_owner      = this;
+        s_queueIndex = queueIndex;
+        if (m_pinWorkers) { pin(queueIndex); }
+
+        while (true) {
+            Job job{ };
+            if (pop(job)) {
+                execute(job);
+                continue;
+            }
+
+            // jobs tend to come in bursts, so look again a few times before going to sleep
+            bool found = false;
+            for (size_t spin = 0; spin < SPIN_COUNT && !found; spin++) {
+                std::this_thread::yield();
+                found = m_queued.load() > 0;
+            }
+            if (found) { continue; }
+
+            std::unique_lock lock{ m_sleepMutex };
+            m_sleeping.fetch_add(1);
+            m_wake.wait(lock, [this] { return m_stopping || m_queued.load() > 0; });
+            m_sleeping.fetch_sub(1);
+            if (m_stopping) { return; }
+        }
+    }
+
+    /// @brief Pins the calling thread to the given CPU core, core 0 is left to the main thread.
+    static void pin([[maybe_unused]] const size_t core)
+    {
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core % std::max(std::thread::hardware_concurrency(), 1u), &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+    }
+};
+
+} // namespace secs
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Component.hpp"
+#include "ECSProperties.hpp"
+
+
+namespace secs
+{
+
+/**
+ * @brief Paged storage of the components of a ComponentList, selected through the PAGE_SIZE of a
+ * ComponentLayout. Offers the interface of ComponentVector, but stores the components in pages of
+ * PAGE_SIZE components that are never moved once allocated. Adding components therefore never
+ * relocates existing ones, which keeps references to them valid and bounds the cost of growing to
+ * a single page allocation.
+ *
+ * Each page is aligned to STORAGE_ALIGNMENT and padded to a multiple of it.
+ */
+template <typename T, size_t PAGE_SIZE>
+    requires(PAGE_SIZE > 0)
+class PagedVector
+{
+public:
+    PagedVector() = default;
+
+    ~PagedVector()
+    {
+        clear();
+        for (T* page : m_pages) { deallocate(page); }
+    }
+
+    PagedVector(const PagedVector&)            = delete;
+    PagedVector& operator=(const PagedVector&) = delete;
+
+    /// @brief Constructs a component at the back and returns it. Allocates a new page if the last
+    /// one is full, existing components stay where they are.
+    template <typename... Args>
+    T& emplaceBack(Args&&... args)
+    {
+        if (m_size == allocatedSize()) { m_pages.push_back(allocate()); }
+        T* component = new(address(m_size)) T(std::forward<Args>(args)...);
+        m_size++;
+        return *component;
+    }
+
+    /// @brief Appends count copies of the component at the given index.
+    void appendCopies(const size_t index, const size_t count)
+    {
+        reserve(m_size + count);
+        const T& source = (*this)[index];
+        for (size_t i = 0; i < count; i++) {
+            new(address(m_size)) T(source);
+            m_size++;
+        }
+    }
+
+    /// @brief Destroys the component at the given index and fills the hole with the last one.
+    void swapRemove(const size_t index)
+    {
+        const size_t last = m_size - 1;
+        destroy(address(index));
+        if (index != last) { relocate(address(index), address(last)); }
+        m_size--;
+    }
+
+    /// @brief Destroys all components, keeping the allocated pages.
+    void clear()
+    {
+        for (size_t i = 0; i < m_size; i++) { destroy(address(i)); }
+        m_size = 0;
+    }
+
+    /// @brief Allocates pages until capacity components fit.
+    void reserve(const size_t capacity)
+    {
+        while (allocatedSize() < capacity) { m_pages.push_back(allocate()); }
+    }
+
+    /// @brief Releases all pages that hold no components.
+    void shrinkToFit()
+    {
+        const size_t usedPages = (m_size + PAGE_SIZE - 1) / PAGE_SIZE;
+        for (size_t i = usedPages; i < m_pages.size(); i++) { deallocate(m_pages[i]); }
+        m_pages.resize(usedPages);
+        m_pages.shrink_to_fit();
+    }
+
+    [[nodiscard]] size_t size() const { return m_size; }
+
+    /// @brief Returns the amount of pages holding components.
+    [[nodiscard]] size_t pageCount() const { return (m_size + PAGE_SIZE - 1) / PAGE_SIZE; }
+
+    /// @brief Returns the first component of the given page.
+    [[nodiscard]] T* page(const size_t page) const { return m_pages[page]; }
+
+    T& operator[](const size_t index) { return *address(index); }
+    const T& operator[](const size_t index) const { return *address(index); }
+
+    T& back() { return *address(m_size - 1); }
+
+private:
+    static constexpr size_t ALIGNMENT = std::max(STORAGE_ALIGNMENT, alignof(T));
+
+    /// @brief The size in bytes of a page, rounded up to STORAGE_ALIGNMENT.
+    static constexpr size_t PAGE_BYTES =
+        (PAGE_SIZE * sizeof(T) + STORAGE_ALIGNMENT - 1) / STORAGE_ALIGNMENT * STORAGE_ALIGNMENT;
+
+    /// @brief The pages, of which the first size() / PAGE_SIZE are full. Only this table of
+    /// pointers is reallocated when growing.
+    std::vector<T*> m_pages{ };
+    size_t m_size = 0;
+
+    [[nodiscard]] size_t allocatedSize() const { return m_pages.size() * PAGE_SIZE; }
+
+    [[nodiscard]] T* address(const size_t index) const
+    {
+        return m_pages[index / PAGE_SIZE] + index % PAGE_SIZE;
+    }
+
+    /// @brief Moves the component at src into the uninitialized memory at dst, ending the lifetime
+    /// of the component at src.
+    static void relocate(T* dst, T* src)
+    {
+        if constexpr (isTriviallyRelocatable<T>) {
+            std::memcpy(static_cast<void*>(dst), static_cast<const void*>(src), sizeof(T));
+        } else {
+            new(dst) T(std::move(*src));
+            std::destroy_at(src);
+        }
+    }
+
+    static void destroy(T* component)
+    {
+        if constexpr (!std::is_trivially_destructible_v<T>) { std::destroy_at(component); }
+    }
+
+    static T* allocate()
+    {
+        return static_cast<T*>(::operator new(PAGE_BYTES, std::align_val_t{ ALIGNMENT }));
+    }
+
+    static void deallocate(T* page) { ::operator delete(page, std::align_val_t{ ALIGNMENT }); }
+};
+
+} // namespace secs
@@ -0,0 +1,13 @@
+#pragma once
+
+namespace secs
+{
+
+/**
+ * @brief Tag component marking an entity as a prefab, i.e. a template that Scene::instantiate()
+ * copies. Queries and views skip prefabs unless one of their terms names Prefab explicitly, and
+ * instances do not inherit the tag.
+ */
+struct Prefab { };
+
+} // namespace secs
@@ -0,0 +1,301 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "ChangeTicks.hpp"
+#include "Component.hpp"
+#include "ComponentBitMap.hpp"
+#include "ComponentMask.hpp"
+#include "ComponentMaskPlanes.hpp"
+#include "Prefab.hpp"
+
+
+namespace secs
+{
+
+/// @brief Query term matching only entities that do NOT have component T.
+template <typename T>
+    requires(Component<T>)
+struct Without { };
+
+/// @brief Query term that does not affect matching. Iteration hands out a T* that is nullptr for
+/// entities without component T.
+template <typename T>
+    requires(Component<T>)
+struct Optional { };
+
+/// @brief Query term matching entities whose component T was added since the running system last
+/// ran. Implies T is required, but hands out nothing.
+template <typename T>
+    requires(Component<T>)
+struct Added { };
+
+/// @brief Query term matching entities whose component T was added or changed since the running
+/// system last ran. Implies T is required, but hands out nothing.
+template <typename T>
+    requires(Component<T>)
+struct Changed { };
+
+/// @brief Query term matching entities that have at least one of the components Ts.
+template <typename... Ts>
+    requires(sizeof...(Ts) > 0 && (Component<Ts> && ...))
+struct AnyOf { };
+
+/**
+ * @brief The mask form of a query. An entity matches if it has all bits of all, none of the bits of
+ * none, and, if any is not empty, at least one bit of any.
+ */
+struct QueryMask
+{
+    ComponentMask all{ };
+    ComponentMask none{ };
+    ComponentMask any{ };
+    /// @brief The amount of leading mask words holding bits of this query. Masks are only tested on
+    /// these words, so matching does not slow down as MAX_COMPONENTS grows. Derived by trim().
+    size_t words = 0;
+    /// @brief Whether any holds bits, so matching does not have to test it. Derived by trim().
+    bool hasAny = false;
+
+    /// @brief Checks if an entity with the given mask matches this query.
+    [[nodiscard]] bool matches(const ComponentMask& mask) const
+    {
+        return mask.containsAll(all, words) && !mask.intersects(none, words)
+            && (!hasAny || mask.intersects(any, words));
+    }
+
+    /// @brief Checks if the mask at the given position of masks matches this query, reading only
+    /// the planes of the first words.
+    [[nodiscard]] bool matches(const ComponentMaskPlanes& masks, const size_t position) const
+    {
+        uint64_t anyHits = 0;
+        for (size_t word = 0; word < words; word++) {
+            const uint64_t mask = masks.plane(word)[position];
+            if ((mask & all.word(word)) != all.word(word)) { return false; }
+            if ((mask & none.word(word)) != 0) { return false; }
+            anyHits |= mask & any.word(word);
+        }
+        return !hasAny || anyHits != 0;
+    }
+
+    /// @brief Appends the position of every mask in masks that matches this query to positions.
+    /// Only the planes of the first words are read. With AVX2, four masks are tested per
+    /// instruction and plane, whatever the width of a mask.
+    void scan(const ComponentMaskPlanes& masks, std::vector<uint32_t>& positions) const
+    {
+        size_t i = 0;
+#if defined(__AVX2__)
+        const __m256i zero = _mm256_setzero_si256();
+        // plain arrays, std::array would drop the alignment attribute of __m256i
+        __m256i allBits[ComponentMask::WORDS];
+        __m256i noneBits[ComponentMask::WORDS];
+        __m256i anyBits[ComponentMask::WORDS];
+        for (size_t word = 0; word < words; word++) {
+            allBits[word]  = _mm256_set1_epi64x(static_cast<int64_t>(all.word(word)));
+            noneBits[word] = _mm256_set1_epi64x(static_cast<int64_t>(none.word(word)));
+            anyBits[word]  = _mm256_set1_epi64x(static_cast<int64_t>(any.word(word)));
+        }
+
+        for (; i + 4 <= masks.size(); i += 4) {
+            __m256i result  = _mm256_cmpeq_epi64(zero, zero);
+            __m256i anyHits = zero;
+            for (size_t word = 0; word < words; word++) {
+                const __m256i mask = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(masks.plane(word).data() + i)
+                );
+                result = _mm256_and_si256(
+                    result,
+                    _mm256_cmpeq_epi64(_mm256_and_si256(mask, allBits[word]), allBits[word])
+                );
+                result = _mm256_and_si256(
+                    result,
+                    _mm256_cmpeq_epi64(_mm256_and_si256(mask, noneBits[word]), zero)
+                );
+                anyHits = _mm256_or_si256(anyHits, _mm256_and_si256(mask, anyBits[word]));
+            }
+            if (hasAny) {
+                result = _mm256_andnot_si256(_mm256_cmpeq_epi64(anyHits, zero), result);
+            }
+
+            // one bit per matching mask
+            auto bits = static_cast<uint32_t>(_mm256_movemask_pd(_mm256_castsi256_pd(result)));
+            while (bits != 0) {
+                positions.push_back(static_cast<uint32_t>(i + std::countr_zero(bits)));
+                bits &= bits - 1;
+            }
+        }
+#endif
+        for (; i < masks.size(); i++) {
+            if (matches(masks, i)) { positions.push_back(static_cast<uint32_t>(i)); }
+        }
+    }
+
+    /// @brief Recomputes words and hasAny, must be called after changing all, none or any.
+    void trim()
+    {
+        words  = std::max({ all.usedWords(), none.usedWords(), any.usedWords() });
+        hasAny = any.any();
+    }
+
+    bool operator==(const QueryMask& other) const = default;
+};
+
+/// @brief Describes how a single query term affects matching and iteration.
+enum QueryTermKind
+{
+    REQUIRED_TERM, // plain T, hands out T&
+    EXCLUDED_TERM, // Without<T>, hands out nothing
+    OPTIONAL_TERM, // Optional<T>, hands out T*
+    ANY_OF_TERM,   // AnyOf<Ts...>, hands out nothing
+    ADDED_TERM,    // Added<T>, hands out nothing
+    CHANGED_TERM,  // Changed<T>, hands out nothing
+};
+
+template <typename T>
+struct QueryTerm
+{
+    using Type                          = T;
+    static constexpr QueryTermKind KIND = REQUIRED_TERM;
+
+    static void apply(QueryMask& query) { query.all.set(ComponentBitMap::getBitIndex<T>()); }
+};
+
+template <typename T>
+struct QueryTerm<Without<T>>
+{
+    using Type                          = T;
+    static constexpr QueryTermKind KIND = EXCLUDED_TERM;
+
+    static void apply(QueryMask& query) { query.none.set(ComponentBitMap::getBitIndex<T>()); }
+};
+
+template <typename T>
+struct QueryTerm<Optional<T>>
+{
+    using Type                          = T;
+    static constexpr QueryTermKind KIND = OPTIONAL_TERM;
+
+    static void apply(QueryMask&) { }
+};
+
+template <typename T>
+struct QueryTerm<Added<T>>
+{
+    static_assert(!TagComponent<T>, "Tag components have no change ticks");
+
+    using Type                          = T;
+    static constexpr QueryTermKind KIND = ADDED_TERM;
+
+    static void apply(QueryMask& query) { query.all.set(ComponentBitMap::getBitIndex<T>()); }
+
+    /// @brief Checks if a component with the given ticks passes this filter.
+    static bool passes(const ComponentTicks& ticks, const Tick since)
+    {
+        return ticks.isAdded(since);
+    }
+};
+
+template <typename T>
+struct QueryTerm<Changed<T>>
+{
+    static_assert(!TagComponent<T>, "Tag components have no change ticks");
+
+    using Type                          = T;
+    static constexpr QueryTermKind KIND = CHANGED_TERM;
+
+    static void apply(QueryMask& query) { query.all.set(ComponentBitMap::getBitIndex<T>()); }
+
+    /// @brief Checks if a component with the given ticks passes this filter.
+    static bool passes(const ComponentTicks& ticks, const Tick since)
+    {
+        return ticks.isChanged(since);
+    }
+};
+
+template <typename... Ts>
+struct QueryTerm<AnyOf<Ts...>>
+{
+    using Type                          = void;
+    static constexpr QueryTermKind KIND = ANY_OF_TERM;
+
+    static void apply(QueryMask& query) { (query.any.set(ComponentBitMap::getBitIndex<Ts>()), ...); }
+};
+
+/// @brief Builds the QueryMask of the given terms. Prefabs are excluded unless a term names Prefab.
+template <typename... Terms>
+QueryMask makeQueryMask()
+{
+    QueryMask query{ };
+    // fold expression, applies the LHS expression to each Term
+    (QueryTerm<Terms>::apply(query), ...);
+    if constexpr (!(std::is_same_v<typename QueryTerm<Terms>::Type, Prefab> || ...)) {
+        query.none.set(ComponentBitMap::getBitIndex<Prefab>());
+    }
+    query.trim();
+    return query;
+}
+
+/// @brief Checks if the term hands out an argument during iteration.
+template <typename Term>
+constexpr bool isFetchedTerm()
+{
+    return QueryTerm<Term>::KIND == REQUIRED_TERM || QueryTerm<Term>::KIND == OPTIONAL_TERM;
+}
+
+/// @brief Checks if the term requires its component to be present.
+template <typename Term>
+constexpr bool isRequiredTerm()
+{
+    constexpr QueryTermKind kind = QueryTerm<Term>::KIND;
+    return kind == REQUIRED_TERM || kind == ADDED_TERM || kind == CHANGED_TERM;
+}
+
+/// @brief Checks if the term names a tag component, which has no storage to read from.
+template <typename Term>
+constexpr bool isTagTerm()
+{
+    return TagComponent<typename QueryTerm<Term>::Type>;
+}
+
+/// @brief Checks if the term filters on the change ticks of its component.
+template <typename Term>
+constexpr bool isTickTerm()
+{
+    return QueryTerm<Term>::KIND == ADDED_TERM || QueryTerm<Term>::KIND == CHANGED_TERM;
+}
+
+/// @brief Checks if any of the terms filters on change ticks. Such queries can not be answered
+/// from masks alone.
+template <typename... Terms>
+constexpr bool hasTickTerms()
+{
+    return (isTickTerm<Terms>() || ...);
+}
+
+/// @brief Checks if Term is either a component or one of the query filters above.
+template <typename Term>
+constexpr bool isQueryTerm()
+{
+    return QueryTerm<Term>::KIND != REQUIRED_TERM || Component<Term>;
+}
+
+} // namespace secs
+
+template <>
+struct std::hash<secs::QueryMask>
+{
+    size_t operator()(const secs::QueryMask& query) const noexcept
+    {
+        const std::hash<secs::ComponentMask> hash{ };
+        size_t seed = hash(query.all);
+        seed ^= hash(query.none) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        seed ^= hash(query.any) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        return seed;
+    }
+};
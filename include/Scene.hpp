@@ -1,10 +1,24 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+
+#include "ArchetypeManager.hpp"
+#include "Bundle.hpp"
+#include "ChangeTicks.hpp"
+#include "CommandBuffer.hpp"
 #include "ComponentManager.hpp"
 #include "SingletonManager.hpp"
 #include "SystemManager.hpp"
 #include "ComponentBitMap.hpp"
+#include "ECSProperties.hpp"
 #include "EntityManager.hpp"
+#include "JobSystem.hpp"
+#include "Prefab.hpp"
+#include "Query.hpp"
+#include "View.hpp"
 
 
 namespace secs
@@ -21,22 +35,221 @@ public:
     Scene()  = default;
     ~Scene() = default;
 
+    /// @brief Creates a scene with the given properties.
+    explicit Scene(const SceneProperties& properties)
+        : m_properties(properties),
+          m_jobSystem(std::make_unique<JobSystem>(properties.workerCount, properties.pinWorkers)),
+          m_commandBuffers(m_jobSystem->workerCount() + 1),
+          m_entityManager(properties.queryEngine)
+    {
+    }
+
     /// @brief Create and return an EntityHandle
     EntityHandle create()
     {
+        assertNotIterating();
         const auto entity = m_entityManager.create();
+        if (isArchetypeStorage()) { m_archetypeManager.create(entity); }
         return entity;
     }
 
 
+    /// @brief Creates count entities at once, the i-th entity receiving the components of the
+    /// Bundle makeBundle(i) returns. Every entity is created with all of its components in a single
+    /// structural change, and the storage is reserved once up front.
+    template <typename Fn>
+        requires(isBundle<std::invoke_result_t<Fn&, size_t>>)
+    std::vector<EntityHandle> createMany(const size_t count, Fn&& makeBundle)
+    {
+        using BundleType = std::invoke_result_t<Fn&, size_t>;
+        return createMany(count, makeBundle, std::type_identity<BundleType>{ });
+    }
+
+    /// @brief Creates count entities at once, each receiving a copy of the components of bundle.
+    template <typename... Ts>
+        requires((std::is_copy_constructible_v<Ts> && ...))
+    std::vector<EntityHandle> createMany(const size_t count, const Bundle<Ts...>& bundle)
+    {
+        return createMany(count, [&bundle](size_t) { return bundle; });
+    }
+
+    /// @brief Creates an entity tagged as Prefab. Queries and views skip it, and its components
+    /// serve as the template of the entities instantiate() creates.
+    EntityHandle createPrefab()
+    {
+        const EntityHandle prefab = create();
+        emplace<Prefab>(prefab);
+        return prefab;
+    }
+
+    /// @brief Creates count entities holding copies of all components of the given prefab, except
+    /// for the Prefab tag itself. The components are copied through their type erased copy
+    /// routines, byte wise for trivially copyable types, and the copies of each component type are
+    /// placed next to each other in storage. Every component must be copy constructible.
+    std::vector<EntityHandle> instantiate(const EntityHandle prefab, const size_t count)
+    {
+        SecsAssert(
+            m_entityManager.isAlive(prefab),
+            "Attempting to instantiate a non existing entity"
+        );
+        assertNotIterating();
+
+        const ComponentMask mask = ComponentMask{ m_entityManager.getMask(prefab) }.reset(
+            ComponentBitMap::getBitIndex<Prefab>()
+        );
+        std::vector<EntityHandle> entities = m_entityManager.createMany(count, mask);
+        if (isArchetypeStorage()) {
+            m_archetypeManager.instantiate(prefab, mask, entities, m_ticks.current);
+        } else {
+            m_componentManager.instantiate(prefab, mask, entities, m_ticks.current);
+        }
+        return entities;
+    }
+
+    /// @brief Creates a new entity holding copies of all components of the given entity. Same as
+    /// instantiate() with a count of one.
+    EntityHandle clone(const EntityHandle entity)
+    {
+        return instantiate(entity, 1).front();
+    }
+
+    /// @brief Registers the component types Ts up front: assigns their bit indices in the given
+    /// order and sets up their storage, so none of this happens the first time a type is used,
+    /// e.g. in the middle of the first frame.
+    template <typename... Ts>
+        requires(sizeof...(Ts) > 0 && (Component<Ts> && ...))
+    void registerComponents()
+    {
+        ComponentBitMap::registerComponents<Ts...>();
+        if (isArchetypeStorage()) {
+            m_archetypeManager.registerComponents<Ts...>();
+        } else {
+            m_componentManager.registerComponents<Ts...>();
+        }
+    }
+
+    /// @brief Reserves room for the given amount of entities in every entity table, so creating up
+    /// to entityCount entities does not reallocate.
+    void reserve(const size_t entityCount)
+    {
+        m_entityManager.reserve(entityCount);
+        if (isArchetypeStorage()) { m_archetypeManager.reserve(entityCount); }
+    }
+
+    /// @brief Reserves room for count components of each of the types Ts. With list storage every
+    /// list is reserved on its own, with archetype storage the chunks of the archetype holding
+    /// exactly the components Ts are allocated.
+    template <typename... Ts>
+        requires(sizeof...(Ts) > 0 && (Component<Ts> && ...))
+    void reserve(const size_t count)
+    {
+        if (isArchetypeStorage()) {
+            m_archetypeManager.reserve<Ts...>(count);
+        } else {
+            (m_componentManager.reserve<Ts>(count), ...);
+        }
+    }
+
+    /// @brief Releases memory that is not needed to hold the current entities and components, e.g.
+    /// after unloading a large level.
+    void shrinkToFit()
+    {
+        assertNotIterating();
+        m_entityManager.shrinkToFit();
+        if (isArchetypeStorage()) {
+            m_archetypeManager.shrinkToFit();
+        } else {
+            m_componentManager.shrinkToFit();
+        }
+        for (CommandBuffer& buffer : m_commandBuffers) { buffer.shrinkToFit(); }
+    }
+
     /// @brief Destroys the given entity.
     void destroy(EntityHandle entity)
     {
-        if (!entity) {
+        if (!m_entityManager.isAlive(entity)) {
             return;
         }
+        assertNotIterating();
+        recordDestroyed(std::span{ &entity, 1 });
+        if (isArchetypeStorage()) {
+            m_archetypeManager.destroy(entity);
+        } else {
+            m_componentManager.destroy(entity);
+        }
         m_entityManager.destroy(entity);
-        m_componentManager.destroy(entity);
+    }
+
+    /// @brief Destroys all entities matching the given query terms. Works per storage instead of
+    /// per entity: with list storage each component list removes the whole batch in one go, with
+    /// archetype storage every matching archetype is cleared as a whole.
+    template <typename... Terms>
+        requires(sizeof...(Terms) > 0 && (isQueryTerm<Terms>() && ...) && !hasTickTerms<Terms...>())
+    void destroyWith()
+    {
+        assertNotIterating();
+        const QueryMask query = makeQueryMask<Terms...>();
+
+        std::vector<EntityHandle> entities{ };
+        if (isArchetypeStorage()) {
+            m_archetypeManager.destroyWith(query, entities);
+        } else {
+            entities = m_entityManager.getWith(query);
+            m_componentManager.destroyMany(entities);
+        }
+        recordDestroyed(entities);
+        m_entityManager.destroyMany(entities);
+    }
+
+    /// @brief Destroys all entities. The component storages are truncated and the entity masks are
+    /// reset wholesale instead of destroying entity by entity.
+    void destroyAll()
+    {
+        assertNotIterating();
+        recordDestroyed(m_entityManager.alive());
+        if (isArchetypeStorage()) {
+            m_archetypeManager.destroyAll();
+        } else {
+            m_componentManager.destroyAll();
+        }
+        m_entityManager.destroyAll();
+    }
+
+    /// @brief Removes the component of type T from all entities. With list storage the list is
+    /// truncated as a whole, with archetype storage each archetype with T is moved as a whole, and
+    /// the masks are updated in a single pass.
+    template <typename T>
+        requires(Component<T>)
+    void clear()
+    {
+        assertNotIterating();
+        const size_t componentIndex = ComponentBitMap::getBitIndex<T>();
+
+        std::vector<EntityHandle> collected{ };
+        std::span<const EntityHandle> entities{ };
+        if (isArchetypeStorage()) {
+            m_archetypeManager.clear<T>(collected);
+            entities = collected;
+        } else if constexpr (TagComponent<T>) {
+            // tags have no list, so their entities are found through the masks
+            QueryMask query{ };
+            query.all.set(componentIndex);
+            query.trim();
+            m_entityManager.getWith(query, collected);
+            entities = collected;
+        } else {
+            entities = m_componentManager.getEntities<T>();
+        }
+
+        if (logsRemovals()) { m_removedLog.recordMany(componentIndex, entities, m_ticks.current); }
+        m_entityManager.clear<T>(entities);
+        if (!isArchetypeStorage()) { m_componentManager.clear<T>(); }
+    }
+
+    /// @brief Checks if the entity exists and has not been destroyed yet.
+    [[nodiscard]] bool isAlive(const EntityHandle entity) const
+    {
+        return m_entityManager.isAlive(entity);
     }
 
     /// @brief Returns all alive entities
@@ -45,35 +258,145 @@ public:
         return m_entityManager.getAll();
     }
 
-    /// @brief Default creates a component of type T and assigns it to the given entity. If the
-    /// component already exists on this entity, nothing is changed and a reference to the existing
-    /// component is returned.
+    /// @brief Default creates a component of type T and assigns it to the given entity, marking it
+    /// as added. If the component already exists on this entity, nothing is changed and a reference
+    /// to the existing component is returned.
     template <typename T, typename... Args>
-        requires(std::is_base_of_v<Component, T>)
-    T& emplace(const EntityHandle entity, Args&&... args)
+        requires(Component<T>)
+    ComponentRef<T> emplace(const EntityHandle entity, Args&&... args)
     {
-        SecsAssert(entity, "Attempting to register a component to a non existing entity");
+        SecsAssert(
+            m_entityManager.isAlive(entity),
+            "Attempting to register a component to a non existing entity"
+        );
+        assertNotIterating();
 
         m_entityManager.add<T>(entity);
-        return m_componentManager.emplace<T>(entity, std::forward<Args>(args)...);
+        if (isArchetypeStorage()) {
+            return m_archetypeManager.emplace<T>(
+                entity,
+                m_ticks.current,
+                std::forward<Args>(args)...
+            );
+        }
+        return m_componentManager.emplace<T>(entity, m_ticks.current, std::forward<Args>(args)...);
+    }
+
+    /// @brief Adds all components of the bundle to the given entity in a single structural change.
+    /// Component types the entity already has are left unchanged.
+    template <typename... Ts>
+    void emplace(const EntityHandle entity, Bundle<Ts...> bundle)
+    {
+        SecsAssert(
+            m_entityManager.isAlive(entity),
+            "Attempting to register a component to a non existing entity"
+        );
+        assertNotIterating();
+
+        m_entityManager.add<Ts...>(entity);
+        if (isArchetypeStorage()) {
+            m_archetypeManager.emplace(entity, m_ticks.current, std::move(bundle));
+        } else {
+            m_componentManager.emplace(entity, m_ticks.current, std::move(bundle));
+        }
     }
 
     /// @brief Deletes the relation between the entity and the component of type T.
     template <typename T>
-        requires(std::is_base_of_v<Component, T>)
+        requires(Component<T>)
     void remove(EntityHandle entity)
     {
         if (!entity) {
             return;
         }
+        assertNotIterating();
 
+        if (logsRemovals() && hasComponent<T>(entity)) {
+            m_removedLog.record(ComponentBitMap::getBitIndex<T>(), entity, m_ticks.current);
+        }
         m_entityManager.remove<T>(entity);
-        m_componentManager.remove<T>(entity);
+        if (isArchetypeStorage()) {
+            m_archetypeManager.remove<T>(entity);
+        } else {
+            m_componentManager.remove<T>(entity);
+        }
+    }
+
+    /// @brief Marks the component of type T of the given entity as changed, so Changed<T> queries
+    /// pick it up. Writes through get() or each() are not tracked automatically.
+    template <typename T>
+        requires(Component<T>)
+    void markChanged(const EntityHandle entity)
+    {
+        // tags have no ticks
+        if constexpr (!TagComponent<T>) {
+            if (isArchetypeStorage()) {
+                m_archetypeManager.markChanged<T>(entity, m_ticks.current);
+            } else {
+                m_componentManager.markChanged<T>(entity, m_ticks.current);
+            }
+        }
+    }
+
+    /// @brief Calls fn(T&) on the component of type T of the given entity and marks it as changed.
+    /// Does nothing if the entity does not have the component.
+    template <typename T, typename Fn>
+        requires(Component<T>)
+    void patch(const EntityHandle entity, Fn&& fn)
+    {
+        const ComponentPtr<T> component = getSafe<T>(entity);
+        if (!component) { return; }
+        std::forward<Fn>(fn)(*component);
+        markChanged<T>(entity);
+    }
+
+    /// @brief Returns the change ticks of the component of type T of the given entity, or nullptr
+    /// if it does not have one.
+    template <typename T>
+        requires(Component<T>)
+    const ComponentTicks* getTicks(const EntityHandle entity) const
+    {
+        if constexpr (TagComponent<T>) {
+            return nullptr;
+        } else {
+            if (isArchetypeStorage()) { return m_archetypeManager.getTicks<T>(entity); }
+            return m_componentManager.getTicks<T>(entity);
+        }
+    }
+
+    /// @brief Returns the dense array of all components of type T together with the entities
+    /// owning them, for kernels that process a whole component type without per entity calls. The
+    /// array is aligned and padded to STORAGE_ALIGNMENT. Only list storage keeps components in a
+    /// single array, so this is not available with archetype storage.
+    template <typename T>
+        requires(Component<T>)
+    ComponentStorage<T> storage() const
+    {
+        static_assert(!TagComponent<T>, "Tag components have no storage");
+        SecsAssert(!isArchetypeStorage(), "Component storage access requires LIST_STORAGE");
+        return m_componentManager.storage<T>();
+    }
+
+    /// @brief Returns all entities component T has been removed from since the running system last
+    /// ran, including entities that were destroyed. Outside of systems all recorded removals are
+    /// returned. Removals are only recorded while systems are registered, as only systems read
+    /// them relative to their last run.
+    template <typename T>
+        requires(Component<T>)
+    std::vector<EntityHandle> getRemoved() const
+    {
+        return m_removedLog.getSince(ComponentBitMap::getBitIndex<T>(), SceneTicks::lastRun);
+    }
+
+    /// @brief Returns the tick changes are currently stamped with.
+    [[nodiscard]] Tick getChangeTick() const
+    {
+        return m_ticks.current;
     }
 
     /// @brief Default constructs a singleton component. These are unique in the whole scene
     template <typename T, typename... Args>
-        requires(std::is_base_of_v<Component, T>)
+        requires(Component<T>)
     T& emplaceSingleton(Args&&... args)
     {
         return m_singletonManager.emplaceSingleton<T>(std::forward<Args>(args)...);
@@ -81,7 +404,7 @@ public:
 
     /// @brief Removes the singleton component T if it is present, otherwise nothing happens
     template <typename T>
-        requires(std::is_base_of_v<Component, T>)
+        requires(Component<T>)
     void removeSingleton()
     {
         m_singletonManager.removeSingleton<T>();
@@ -90,7 +413,7 @@ public:
     /// @brief Returns a reference to the singleton of type T. Requires that the singleton exists so
     /// make sure it does!
     template <typename T>
-        requires(std::is_base_of_v<Component, T>)
+        requires(Component<T>)
     T& getSingleton() const
     {
         return static_cast<T&>(m_singletonManager.getSingleton<T>());
@@ -98,7 +421,7 @@ public:
 
     /// @brief Returns a raw pointer to the singleton of type T.
     template <typename T>
-        requires(std::is_base_of_v<Component, T>)
+        requires(Component<T>)
     T* getSingletonSafe() const
     {
         return m_singletonManager.getSingletonSafe<T>();
@@ -106,31 +429,127 @@ public:
 
     /// @brief An unsafe get of the component of type T associated with the given entity
     template <typename T>
-        requires(std::is_base_of_v<Component, T>)
-    T& get(const EntityHandle entity) const
+        requires(Component<T>)
+    ComponentRef<T> get(const EntityHandle entity) const
     {
         SecsAssert(entity, "Performing unsafe get on a non existing entity.");
-        return m_componentManager.get<T>(entity);
+        if constexpr (TagComponent<T>) {
+            SecsAssert(hasComponent<T>(entity), "Failed to get tag Component");
+            return tagInstance<T>();
+        } else {
+            if (isArchetypeStorage()) { return m_archetypeManager.get<T>(entity); }
+            return m_componentManager.get<T>(entity);
+        }
     }
 
     /// @brief A safe get of the component of type T associated with the given entity
     template <typename T>
-        requires(std::is_base_of_v<Component, T>)
-    T* getSafe(const EntityHandle entity) const
+        requires(Component<T>)
+    ComponentPtr<T> getSafe(const EntityHandle entity) const
     {
         if (!entity) { return nullptr; }
-        return m_componentManager.getSafe<T>(entity);
+        if constexpr (TagComponent<T>) {
+            return hasComponent<T>(entity) ? &tagInstance<T>() : nullptr;
+        } else {
+            if (isArchetypeStorage()) { return m_archetypeManager.getSafe<T>(entity); }
+            return m_componentManager.getSafe<T>(entity);
+        }
     }
 
-    /// @brief Returns all entities that have the given components.
-    template <typename... Args>
+    /// @brief Returns all entities matching the given query terms. Besides plain components, the
+    /// terms Without<T>, Optional<T> and AnyOf<Ts...> can be used, which are all evaluated by mask
+    /// arithmetic in the same pass. With archetype storage only the matching archetypes are visited
+    /// instead of every entity, unless the BITSET_QUERY_ENGINE is used, which answers the query
+    /// from the component bitsets in either storage. Added<T> and Changed<T> terms additionally
+    /// check the component ticks.
+    template <typename... Terms>
+        requires((isQueryTerm<Terms>() && ...))
     std::vector<EntityHandle> getWith() const
     {
-        EntityManager::ComponentMask requiredComponents{ };
-        // fold expression, applies the LHS expression to each T in Args
-        (requiredComponents.set(ComponentBitMap::getBitIndex<Args>()), ...);
+        std::vector<EntityHandle> entities{ };
+        getWith<Terms...>(entities);
+        return entities;
+    }
+
+    /// @brief Same as getWith(), but appends the entities to the given vector. Clearing and passing
+    /// the same vector every frame avoids allocating the result over and over.
+    template <typename... Terms>
+        requires((isQueryTerm<Terms>() && ...))
+    void getWith(std::vector<EntityHandle>& entities) const
+    {
+        if constexpr (hasTickTerms<Terms...>()) {
+            each<Terms...>([&](const EntityHandle entity, auto&&...) {
+                entities.push_back(entity);
+            });
+        } else {
+            const QueryMask query = makeQueryMask<Terms...>();
+            if (isArchetypeStorage() && m_properties.queryEngine == MASK_QUERY_ENGINE) {
+                m_archetypeManager.getWith(query, entities);
+            } else {
+                m_entityManager.getWith(query, entities);
+            }
+        }
+    }
 
-        return m_entityManager.getWith(requiredComponents);
+    /// @brief Calls fn(EntityHandle, ...) for every entity matching the given query terms, passing
+    /// T& for each required component and T* for each Optional<T>, or the Ref and RefPointer of
+    /// components with a ComponentLayout. Unlike getWith() this hands out the components directly
+    /// and does not allocate. Added<T> and Changed<T> only match changes
+    /// made since the running system last ran. Adding or removing components or entities inside fn
+    /// is not allowed.
+    template <typename... Terms, typename Fn>
+        requires(sizeof...(Terms) > 0 && (isQueryTerm<Terms>() && ...))
+    void each(Fn&& fn) const
+    {
+        if (isArchetypeStorage()) {
+            m_archetypeManager.each<Terms...>(SceneTicks::lastRun, std::forward<Fn>(fn));
+        } else {
+            m_componentManager.each<Terms...>(
+                m_entityManager,
+                SceneTicks::lastRun,
+                std::forward<Fn>(fn)
+            );
+        }
+    }
+
+    /// @brief Same as each(), but splits the matching entities into ranges of grain entities that
+    /// are processed as jobs on the JobSystem, so fn is called concurrently and must be thread safe
+    /// for the components it touches. The grain is rounded up to a multiple of 64 entities, so
+    /// neighbouring ranges of the component arrays do not share cache lines. Structural changes,
+    /// i.e. creating or destroying entities and adding or removing components, are asserted
+    /// against for the duration of the loop.
+    template <typename... Terms, typename Fn>
+        requires(sizeof...(Terms) > 0 && (isQueryTerm<Terms>() && ...))
+    void parEach(Fn&& fn, const size_t grain = PAR_EACH_GRAIN_SIZE) const
+    {
+        const size_t grainSize = (std::max<size_t>(grain, 1) + 63) / 64 * 64;
+
+        m_parallelIterations.fetch_add(1);
+        if (isArchetypeStorage()) {
+            m_archetypeManager.parEach<Terms...>(SceneTicks::lastRun, *m_jobSystem, grainSize, fn);
+        } else {
+            m_componentManager.parEach<Terms...>(
+                m_entityManager,
+                SceneTicks::lastRun,
+                *m_jobSystem,
+                grainSize,
+                fn
+            );
+        }
+        m_parallelIterations.fetch_sub(1);
+    }
+
+    /// @brief Returns the persistent view of all entities matching the given query terms. The view
+    /// is registered on the first call and kept up to date as components are added and removed, so
+    /// it can be stored and iterated every frame without rebuilding the query. Added<T> and
+    /// Changed<T> depend on the running system and can not be used in views.
+    template <typename... Terms>
+        requires(
+            sizeof...(Terms) > 0 && (isQueryTerm<Terms>() && ...) && !hasTickTerms<Terms...>()
+        )
+    View<Terms...> view()
+    {
+        return View<Terms...>{ m_entityManager.getCreateView(makeQueryMask<Terms...>()), *this };
     }
 
     /// @brief Registers and starts the system T. The onReady() function of T will also be called
@@ -142,37 +561,208 @@ public:
     }
 
     /// @brief Unregisters and stops the system T. The onShutDown() function of T will also be
-    /// called.
+    /// called. Once no system is left, the recorded removals are dropped.
     template <typename T>
         requires(std::is_base_of_v<System, T>)
     bool stop()
     {
-        return m_systemManager.unregisterSystem<T>(*this);
+        const bool stopped = m_systemManager.unregisterSystem<T>(*this);
+        if (m_systemManager.empty()) { m_removedLog.clear(); }
+        return stopped;
     }
 
     /// @brief Checks if the given entity has a component of type T.
     template <typename T>
     bool hasComponent(const EntityHandle entity) const
     {
-        return m_componentManager.hasComponent<T>(entity);
+        if constexpr (TagComponent<T>) {
+            return m_entityManager.isAlive(entity)
+                && m_entityManager.hasBit(entity, ComponentBitMap::getBitIndex<T>());
+        } else {
+            if (isArchetypeStorage()) { return m_archetypeManager.hasComponent<T>(entity); }
+            return m_componentManager.hasComponent<T>(entity);
+        }
     }
 
-    /// @brief Calls the onUpdate method of all active systems.
+    /// @brief Calls the onUpdate method of all active systems. Systems of the same phase that
+    /// declare non conflicting SystemAccess run concurrently, so they must only touch the types
+    /// they declared and must not make structural changes.
     void onUpdate(float delta)
     {
-        m_systemManager.onUpdate(delta, *this);
+        m_removedLog.prune(m_systemManager.getOldestLastRun());
+        m_systemManager.onUpdate(delta, *this, m_ticks, *m_jobSystem, m_commandBuffers);
     }
 
     /// @brief Calls the onDraw method of all active systems.
     void onRender()
     {
-        m_systemManager.onRender(*this);
+        m_removedLog.prune(m_systemManager.getOldestLastRun());
+        m_systemManager.onRender(*this, m_ticks, *m_jobSystem, m_commandBuffers);
+    }
+
+    /// @brief Returns the command buffer of the calling thread. Structural changes recorded into it
+    /// are applied at the end of the current system phase, or on flushCommands(). Every worker of
+    /// the JobSystem has its own buffer, so systems running concurrently can record without
+    /// synchronization.
+    [[nodiscard]] CommandBuffer& getCommandBuffer()
+    {
+        return m_commandBuffers[m_jobSystem->threadIndex()];
+    }
+
+    /// @brief Applies the commands recorded into all command buffers.
+    void flushCommands()
+    {
+        for (CommandBuffer& buffer : m_commandBuffers) { buffer.playback(*this); }
+    }
+
+    /// @brief Returns the job system of this scene. Systems can use it to split their own work into
+    /// jobs, which run on the same workers as the systems themselves.
+    [[nodiscard]] JobSystem& getJobSystem() const
+    {
+        return *m_jobSystem;
+    }
+
+    /// @brief Returns the properties this scene was created with.
+    [[nodiscard]] const SceneProperties& getProperties() const
+    {
+        return m_properties;
     }
 
 private:
+    SceneProperties m_properties{ };
+    std::unique_ptr<JobSystem> m_jobSystem = std::make_unique<JobSystem>();
+    /// @brief One command buffer per thread of the job system.
+    std::vector<CommandBuffer> m_commandBuffers =
+        std::vector<CommandBuffer>(m_jobSystem->workerCount() + 1);
     EntityManager m_entityManager{ };
     ComponentManager m_componentManager{ };
+    ArchetypeManager m_archetypeManager{ };
     SystemManager m_systemManager{ };
     SingletonManager m_singletonManager{ };
+    SceneTicks m_ticks{ };
+    RemovedComponentLog m_removedLog{ };
+    /// @brief The amount of parEach() loops currently running, structural changes are not allowed
+    /// while it is not 0.
+    mutable std::atomic<size_t> m_parallelIterations{ 0 };
+
+    [[nodiscard]] bool isArchetypeStorage() const
+    {
+        return m_properties.storage == ARCHETYPE_STORAGE;
+    }
+
+    template <typename Fn, typename... Ts>
+    std::vector<EntityHandle> createMany(
+        const size_t count,
+        Fn& makeBundle,
+        std::type_identity<Bundle<Ts...>>
+    )
+    {
+        assertNotIterating();
+
+        const ComponentMask mask           = Bundle<Ts...>::mask();
+        std::vector<EntityHandle> entities = m_entityManager.createMany(count, mask);
+        if (isArchetypeStorage()) {
+            m_archetypeManager.createMany<Ts...>(entities, m_ticks.current, makeBundle);
+        } else {
+            m_componentManager.createMany<Ts...>(entities, m_ticks.current, makeBundle);
+        }
+        return entities;
+    }
+
+    /// @brief Checks if removals have to be recorded, which is the case while systems are
+    /// registered. Without systems nobody would prune the log.
+    [[nodiscard]] bool logsRemovals() const
+    {
+        return !m_systemManager.empty();
+    }
+
+    /// @brief Records all components of the given entities as removed, before destroying them.
+    void recordDestroyed(const std::span<const EntityHandle> entities)
+    {
+        if (!logsRemovals()) { return; }
+        for (const EntityHandle entity : entities) {
+            const ComponentMask mask = m_entityManager.getMask(entity);
+            // only visit the set bits of each word
+            for (size_t word = 0; word < ComponentMask::WORDS; word++) {
+                uint64_t bits = mask.word(word);
+                while (bits != 0) {
+                    const size_t index = word * 64 + std::countr_zero(bits);
+                    m_removedLog.record(index, entity, m_ticks.current);
+                    bits &= bits - 1;
+                }
+            }
+        }
+    }
+
+    void assertNotIterating() const
+    {
+        SecsAssert(
+            m_parallelIterations.load() == 0,
+            "Structural changes are not allowed during parEach()"
+        );
+    }
+
+    /// @brief Returns the arguments a query term hands out for the given entity.
+    template <typename Term>
+    auto fetch(const EntityHandle entity) const
+    {
+        if constexpr (QueryTerm<Term>::KIND == REQUIRED_TERM) {
+            using T = typename QueryTerm<Term>::Type;
+            return std::tuple<ComponentRef<T>>{ get<T>(entity) };
+        } else if constexpr (QueryTerm<Term>::KIND == OPTIONAL_TERM) {
+            return std::make_tuple(getSafe<typename QueryTerm<Term>::Type>(entity));
+        } else {
+            return std::tuple<>{ };
+        }
+    }
+
+    template <typename... Terms>
+    friend class View;
 };
+
+template <typename... Terms>
+template <typename Fn>
+void View<Terms...>::each(Fn&& fn) const
+{
+    for (const EntityHandle entity : m_storage->entities()) {
+        std::apply(
+            fn,
+            std::tuple_cat(std::make_tuple(entity), m_scene->template fetch<Terms>(entity)...)
+        );
+    }
+}
+
+inline void CommandBuffer::playback(Scene& scene)
+{
+    if (empty()) { return; }
+
+    m_created.resize(m_createCount);
+    for (EntityHandle& entity : m_created) { entity = scene.create(); }
+
+    // group by component type, so each component storage is touched in one go. Commands on
+    // different component types commute, and the stable sort keeps the order of the emplaces and
+    // removes of each component type, which do not
+    std::ranges::stable_sort(m_components, { }, &ComponentCommand::componentIndex);
+    for (const ComponentCommand& command : m_components) {
+        const EntityHandle entity = resolve(command.entity);
+        if (scene.isAlive(entity)) { command.apply(scene, entity, command.component); }
+    }
+
+    for (const EntityHandle entity : m_destroyed) { scene.destroy(resolve(entity)); }
+
+    clear();
+}
+
+template <typename T>
+void CommandBuffer::applyEmplace(Scene& scene, const EntityHandle entity, void* component)
+{
+    scene.emplace<T>(entity, std::move(*static_cast<T*>(component)));
+}
+
+template <typename T>
+void CommandBuffer::applyRemove(Scene& scene, const EntityHandle entity, void*)
+{
+    scene.remove<T>(entity);
+}
+
 } // namespace siren::ecs
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <array>
+#include <memory>
+
 #include "Component.hpp"
 #include "ComponentBitMap.hpp"
+#include "ECSProperties.hpp"
 
 
 namespace secs
@@ -15,50 +19,60 @@ public:
     /// @brief Default constructs a singleton of type T either with default args or with the
     /// provided args
     template <typename T, typename... Args>
-        requires(std::is_base_of_v<Component, T>)
+        requires(Component<T>)
     T& emplaceSingleton(Args&&... args)
     {
-        const size_t componentIndex = ComponentBitMap::getBitIndex<T>();
-        if (!m_singletons.contains(componentIndex)) {
-            m_singletons.emplace(componentIndex, std::make_unique<T>(std::forward<Args>(args)...));
+        SingletonPtr& singleton = m_singletons[SingletonBitMap::getBitIndex<T>()];
+        if (!singleton) {
+            singleton = SingletonPtr{
+                new T(std::forward<Args>(args)...),
+                Deleter{ [](void* ptr) { delete static_cast<T*>(ptr); } },
+            };
         }
-        return *static_cast<T*>(m_singletons[componentIndex].get());
+        return *static_cast<T*>(singleton.get());
     }
 
     /// @brief Removes the singleton of type T if it exists
     template <typename T>
-        requires(std::is_base_of_v<Component, T>)
+        requires(Component<T>)
     // ReSharper disable once CppMemberFunctionMayBeConst
     void removeSingleton()
     {
-        const size_t componentIndex = ComponentBitMap::getBitIndex<T>();
-        if (!m_singletons.contains(componentIndex)) { return; }
-        m_singletons.erase(componentIndex);
+        m_singletons[SingletonBitMap::getBitIndex<T>()].reset();
     }
 
     /// @brief Returns a reference to the singleton of type T. Requires that the singleton does
     /// exist, so be sure to  make sure it does!
     template <typename T>
-        requires(std::is_base_of_v<Component, T>)
+        requires(Component<T>)
     T& getSingleton() const
     {
-        const size_t componentIndex = ComponentBitMap::getBitIndex<T>();
-        SecsAssert(m_singletons.contains(componentIndex), "Cannot get non existent singleton");
-        return *static_cast<T*>(m_singletons[componentIndex].get());
+        T* singleton = getSingletonSafe<T>();
+        SecsAssert(singleton, "Cannot get non existent singleton");
+        return *singleton;
     }
 
     /// @brief Returns a raw pointer to the singleton of type T.
     template <typename T>
-        requires(std::is_base_of_v<Component, T>)
+        requires(Component<T>)
     T* getSingletonSafe() const
     {
-        const size_t componentIndex = ComponentBitMap::getBitIndex<T>();
-        if (!m_singletons.contains(componentIndex)) { return nullptr; }
-        return static_cast<T*>(m_singletons[componentIndex].get());
+        return static_cast<T*>(m_singletons[SingletonBitMap::getBitIndex<T>()].get());
     }
 
 private:
-    mutable std::unordered_map<size_t, std::unique_ptr<Component>> m_singletons{ };
+    /// @brief Destroys a type erased singleton through a function knowing its actual type.
+    struct Deleter
+    {
+        void (*destroy)(void* ptr);
+
+        void operator()(void* ptr) const { destroy(ptr); }
+    };
+
+    using SingletonPtr = std::unique_ptr<void, Deleter>;
+
+    /// @brief The singleton of each component type, indexed by SingletonBitMap index.
+    std::array<SingletonPtr, MAX_COMPONENTS> m_singletons{ };
 };
 
 } // namespace siren::ecs
@@ -0,0 +1,264 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "ComponentLayout.hpp"
+#include "ComponentVector.hpp"
+#include "PagedVector.hpp"
+
+
+namespace secs
+{
+
+/**
+ * @brief Struct of arrays storage of a LayoutComponent, one ComponentVector per field. Offers the
+ * interface of ComponentVector, but hands out the Ref of the component instead of a T&, and splits
+ * components into their fields when they are added.
+ */
+template <typename T>
+    requires(LayoutComponent<T>)
+class SoAVector
+{
+public:
+    using Ref = ComponentRef<T>;
+
+    /// @brief Constructs a component, moves its fields to the back of the columns and returns it.
+    template <typename... Args>
+    Ref emplaceBack(Args&&... args)
+    {
+        T component(std::forward<Args>(args)...);
+        push(fieldsOf(component), FIELDS);
+        return back();
+    }
+
+    /// @brief Appends count copies of the component at the given index.
+    void appendCopies(const size_t index, const size_t count)
+    {
+        forEachColumn([index, count](auto& column) { column.appendCopies(index, count); });
+    }
+
+    /// @brief Destroys the component at the given index and fills the hole with the last one.
+    void swapRemove(const size_t index)
+    {
+        forEachColumn([index](auto& column) { column.swapRemove(index); });
+    }
+
+    /// @brief Destroys all components, keeping the allocated memory.
+    void clear()
+    {
+        forEachColumn([](auto& column) { column.clear(); });
+    }
+
+    /// @brief Grows the columns to hold at least capacity components without reallocating.
+    void reserve(const size_t capacity)
+    {
+        forEachColumn([capacity](auto& column) { column.reserve(capacity); });
+    }
+
+    /// @brief Shrinks the columns to the current amount of components.
+    void shrinkToFit()
+    {
+        forEachColumn([](auto& column) { column.shrinkToFit(); });
+    }
+
+    [[nodiscard]] size_t size() const { return std::get<0>(m_columns).size(); }
+
+    Ref operator[](const size_t index) { return at(index, FIELDS); }
+
+    Ref back() { return at(size() - 1, FIELDS); }
+
+    /// @brief Returns the column holding the field at index I of all components.
+    template <size_t I>
+    auto& column()
+    {
+        return std::get<I>(m_columns);
+    }
+
+private:
+    using Fields = FieldTypes<T>;
+
+    static constexpr auto FIELDS = std::make_index_sequence<std::tuple_size_v<Fields>>{ };
+
+    template <typename Tuple>
+    struct Columns;
+
+    template <typename... Fs>
+    struct Columns<std::tuple<Fs...>>
+    {
+        using Type = std::tuple<ComponentVector<Fs>...>;
+    };
+
+    /// @brief One column per field of T, all of the same size.
+    typename Columns<Fields>::Type m_columns{ };
+
+    template <typename Fn>
+    void forEachColumn(const Fn& fn)
+    {
+        std::apply([&fn](auto&... columns) { (fn(columns), ...); }, m_columns);
+    }
+
+    template <typename Tuple, size_t... I>
+    void push(const Tuple& fields, std::index_sequence<I...>)
+    {
+        (std::get<I>(m_columns).emplaceBack(std::move(std::get<I>(fields))), ...);
+    }
+
+    template <size_t... I>
+    Ref at(const size_t index, std::index_sequence<I...>)
+    {
+        return Ref{ std::get<I>(m_columns)[index]... };
+    }
+};
+
+/**
+ * @brief Array of structs of arrays storage of a LayoutComponent. Components are stored in blocks
+ * of LANES, each holding one array per field, so a field of all components in a block can be loaded
+ * into a vector register at once. Offers the same interface as SoAVector.
+ */
+template <typename T, size_t LANES>
+    requires(LayoutComponent<T> && LANES > 0)
+class AoSoAVector
+{
+public:
+    using Ref = ComponentRef<T>;
+
+    /// @brief Constructs a component, copies its fields into the lanes of the last block and
+    /// returns it.
+    template <typename... Args>
+    Ref emplaceBack(Args&&... args)
+    {
+        T component(std::forward<Args>(args)...);
+        grow(m_size + 1);
+        store(m_size++, fieldsOf(component), FIELDS);
+        return back();
+    }
+
+    /// @brief Appends count copies of the component at the given index.
+    void appendCopies(const size_t index, const size_t count)
+    {
+        grow(m_size + count);
+        for (size_t i = 0; i < count; i++) { copyLane(m_size++, index, FIELDS); }
+    }
+
+    /// @brief Fills the hole at the given index with the last component. The fields are trivially
+    /// copyable, so nothing has to be destroyed.
+    void swapRemove(const size_t index)
+    {
+        const size_t last = --m_size;
+        if (index != last) { copyLane(index, last, FIELDS); }
+        if (m_size % LANES == 0) { m_blocks.swapRemove(m_blocks.size() - 1); }
+    }
+
+    /// @brief Removes all components, keeping the allocated memory.
+    void clear()
+    {
+        m_blocks.clear();
+        m_size = 0;
+    }
+
+    /// @brief Grows the blocks to hold at least capacity components without reallocating.
+    void reserve(const size_t capacity) { m_blocks.reserve((capacity + LANES - 1) / LANES); }
+
+    /// @brief Shrinks the blocks to the current amount of components.
+    void shrinkToFit() { m_blocks.shrinkToFit(); }
+
+    [[nodiscard]] size_t size() const { return m_size; }
+
+    Ref operator[](const size_t index) { return at(index, FIELDS); }
+
+    Ref back() { return at(m_size - 1, FIELDS); }
+
+private:
+    using Fields = FieldTypes<T>;
+
+    static constexpr auto FIELDS = std::make_index_sequence<std::tuple_size_v<Fields>>{ };
+
+    template <typename Tuple>
+    struct Lanes;
+
+    template <typename... Fs>
+    struct Lanes<std::tuple<Fs...>>
+    {
+        static_assert(
+            (std::is_trivially_copyable_v<Fs> && ...),
+            "ComponentLayout LANES require trivially copyable fields"
+        );
+        using Type = std::tuple<std::array<Fs, LANES>...>;
+    };
+
+    /// @brief LANES components, one array per field, aligned for vector loads.
+    struct alignas(STORAGE_ALIGNMENT) Block
+    {
+        typename Lanes<Fields>::Type lanes{ };
+    };
+
+    ComponentVector<Block> m_blocks{ };
+    size_t m_size = 0;
+
+    /// @brief Adds blocks until count components fit.
+    void grow(const size_t count)
+    {
+        while (m_blocks.size() * LANES < count) { m_blocks.emplaceBack(); }
+    }
+
+    template <size_t I>
+    auto& field(const size_t index)
+    {
+        return std::get<I>(m_blocks[index / LANES].lanes)[index % LANES];
+    }
+
+    template <typename Tuple, size_t... I>
+    void store(const size_t index, const Tuple& fields, std::index_sequence<I...>)
+    {
+        ((field<I>(index) = std::get<I>(fields)), ...);
+    }
+
+    template <size_t... I>
+    void copyLane(const size_t dst, const size_t src, std::index_sequence<I...>)
+    {
+        ((field<I>(dst) = field<I>(src)), ...);
+    }
+
+    template <size_t... I>
+    Ref at(const size_t index, std::index_sequence<I...>)
+    {
+        return Ref{ field<I>(index)... };
+    }
+};
+
+/// @brief The dense array ComponentList stores components of type T in.
+template <typename T>
+struct DenseStorage
+{
+    using Type = ComponentVector<T>;
+};
+
+template <typename T>
+    requires(LayoutComponent<T>)
+struct DenseStorage<T>
+{
+    static_assert(
+        layoutPageSize<T>() == 0,
+        "ComponentLayout PAGE_SIZE can not be combined with a Ref"
+    );
+
+    using Type = std::conditional_t<
+        layoutLanes<T>() == 0,
+        SoAVector<T>,
+        AoSoAVector<T, std::max<size_t>(layoutLanes<T>(), 1)>
+    >;
+};
+
+template <typename T>
+    requires(PagedComponent<T>)
+struct DenseStorage<T>
+{
+    using Type = PagedVector<T, layoutPageSize<T>()>;
+};
+
+} // namespace secs
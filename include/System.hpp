@@ -1,5 +1,8 @@
 #pragma once
 
+#include "SystemAccess.hpp"
+
+
 namespace secs
 {
 
@@ -14,6 +17,10 @@ class System
 public:
     virtual ~System() = default;
 
+    /// @brief Returns the components and singletons this system reads and writes. Is queried once
+    /// on registration. Systems that do not override this never run concurrently with others.
+    [[nodiscard]] virtual SystemAccess getAccess() const { return SystemAccess::all(); }
+
     /// @brief Is called once as soon as the system becomes active
     virtual void onReady(Scene& scene) { }
 
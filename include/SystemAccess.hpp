@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Component.hpp"
+#include "ComponentBitMap.hpp"
+#include "ComponentMask.hpp"
+
+
+namespace secs
+{
+
+/**
+ * @brief Describes which component and singleton types a system reads and writes. Systems of the
+ * same phase whose accesses do not conflict are run concurrently. Singletons are indexed by the
+ * SingletonBitMap, so they are declared separately from components.
+ */
+struct SystemAccess
+{
+    ComponentMask reads{ };
+    ComponentMask writes{ };
+    ComponentMask singletonReads{ };
+    ComponentMask singletonWrites{ };
+    /// @brief The system may touch anything, including structural changes such as creating
+    /// entities or adding components, and never runs concurrently with another system.
+    bool exclusive = false;
+
+    /// @brief Declares that the system reads the components Ts.
+    template <typename... Ts>
+        requires((Component<Ts> && ...))
+    SystemAccess& read()
+    {
+        (reads.set(ComponentBitMap::getBitIndex<Ts>()), ...);
+        return *this;
+    }
+
+    /// @brief Declares that the system reads and writes the components Ts.
+    template <typename... Ts>
+        requires((Component<Ts> && ...))
+    SystemAccess& write()
+    {
+        (writes.set(ComponentBitMap::getBitIndex<Ts>()), ...);
+        return *this;
+    }
+
+    /// @brief Declares that the system reads the singletons Ts.
+    template <typename... Ts>
+        requires((Component<Ts> && ...))
+    SystemAccess& readSingleton()
+    {
+        (singletonReads.set(SingletonBitMap::getBitIndex<Ts>()), ...);
+        return *this;
+    }
+
+    /// @brief Declares that the system reads and writes the singletons Ts.
+    template <typename... Ts>
+        requires((Component<Ts> && ...))
+    SystemAccess& writeSingleton()
+    {
+        (singletonWrites.set(SingletonBitMap::getBitIndex<Ts>()), ...);
+        return *this;
+    }
+
+    /// @brief Returns an exclusive access, which conflicts with every other system.
+    static SystemAccess all()
+    {
+        SystemAccess access{ };
+        access.exclusive = true;
+        return access;
+    }
+
+    /// @brief Checks if two systems with these accesses can not run at the same time.
+    [[nodiscard]] bool conflicts(const SystemAccess& other) const
+    {
+        if (exclusive || other.exclusive) { return true; }
+        return overlaps(reads, writes, other.reads, other.writes)
+            || overlaps(
+                singletonReads,
+                singletonWrites,
+                other.singletonReads,
+                other.singletonWrites
+            );
+    }
+
+private:
+    /// @brief Checks if the writes of either side touch the reads or writes of the other side.
+    static bool overlaps(
+        const ComponentMask& reads,
+        const ComponentMask& writes,
+        const ComponentMask& otherReads,
+        const ComponentMask& otherWrites
+    )
+    {
+        return (writes & (otherReads | otherWrites)).any() || (otherWrites & reads).any();
+    }
+};
+
+} // namespace secs
@@ -1,7 +1,14 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <ranges>
+#include <span>
+#include <unordered_map>
 
+#include "ChangeTicks.hpp"
+#include "CommandBuffer.hpp"
+#include "JobSystem.hpp"
 #include "System.hpp"
 #include "SystemPhase.hpp"
 
@@ -20,14 +27,16 @@ public:
         requires(std::is_base_of_v<System, T>)
     bool registerSystem(Scene& scene, const SystemPhase phase)
     {
-        const std::type_index systemIndex = index<T>();
+        const size_t systemIndex = index<T>();
         if (m_registeredSystems.contains(systemIndex)) { return false; }
 
-        m_systems[phase][systemIndex] = std::unique_ptr<System>(new T());
-        const auto& system            = m_systems[phase][systemIndex];
-        system->onReady(scene); // maybe we want to only call this on scene start
+        m_systems[phase][systemIndex] = SystemEntry{ std::unique_ptr<System>(new T()), 0, 0, { } };
+        auto& entry                   = m_systems[phase][systemIndex];
+        entry.access                  = entry.system->getAccess();
+        entry.system->onReady(scene); // maybe we want to only call this on scene start
 
         m_registeredSystems[systemIndex] = phase;
+        m_scheduleDirty                  = true;
 
         return true;
     }
@@ -38,43 +47,75 @@ public:
         requires(std::is_base_of_v<System, T>)
     bool unregisterSystem(Scene& scene)
     {
-        const std::type_index systemIndex = index<T>();
+        const size_t systemIndex = index<T>();
         if (!m_registeredSystems.contains(systemIndex)) { return false; }
 
         const SystemPhase phase = m_registeredSystems[systemIndex];
         m_registeredSystems.erase(systemIndex);
 
-        m_systems[phase][systemIndex]->onShutdown(scene);
+        m_systems[phase][systemIndex].system->onShutdown(scene);
         m_systems[phase].erase(systemIndex);
+        m_scheduleDirty = true;
 
         return true;
     }
 
-    /// @brief Calls the onUpdate() method of all active systems in no specific order.
-    void onUpdate(const float delta, Scene& scene) const
+    /// @brief Calls the onUpdate() method of all active systems. Phases run one after another,
+    /// while systems of the same phase whose SystemAccess does not conflict run concurrently.
+    /// While a system runs, SceneTicks::lastRun is the tick its onUpdate() last ran at, so its
+    /// Added<T> and Changed<T> queries only see changes that happened since. The given command
+    /// buffers are played back at the end of every phase.
+    void onUpdate(
+        const float delta,
+        Scene& scene,
+        SceneTicks& ticks,
+        JobSystem& jobs,
+        const std::span<CommandBuffer> commands
+    )
     {
-        for (const auto& bucket : m_systems) {
-            for (const auto& system : bucket | std::views::values) {
-                system->onUpdate(delta, scene);
-            }
-        }
+        runAll(scene, ticks, jobs, commands, &SystemEntry::lastUpdate, [&](System& system) {
+            system.onUpdate(delta, scene);
+        });
+    }
+
+    /// @brief Calls the onRender() method of all active systems, scheduled like onUpdate(). The
+    /// render passes track their own last run tick, so rendering does not hide changes from the
+    /// next onUpdate() of the same system.
+    void onRender(
+        Scene& scene,
+        SceneTicks& ticks,
+        JobSystem& jobs,
+        const std::span<CommandBuffer> commands
+    )
+    {
+        m_rendered = true;
+        runAll(scene, ticks, jobs, commands, &SystemEntry::lastRender, [&](System& system) {
+            system.onRender(scene);
+        });
     }
 
-    /// @brief Calls the onUpdate() method of all active systems in no specific order.
-    void onRender(Scene& scene) const
+    /// @brief Checks if no system is registered.
+    [[nodiscard]] bool empty() const { return m_registeredSystems.empty(); }
+
+    /// @brief Returns the oldest tick any registered system last ran at. Changes older than this
+    /// have been seen by every system, by both its update and render pass once rendering started.
+    [[nodiscard]] Tick getOldestLastRun() const
     {
+        Tick oldest = UINT64_MAX;
         for (const auto& bucket : m_systems) {
-            for (const auto& system : bucket | std::views::values) {
-                system->onRender(scene);
+            for (const auto& entry : bucket | std::views::values) {
+                oldest = std::min(oldest, entry.lastUpdate);
+                if (m_rendered) { oldest = std::min(oldest, entry.lastRender); }
             }
         }
+        return oldest;
     }
 
     void onPause(Scene& scene) const
     {
         for (const auto& bucket : m_systems) {
-            for (const auto& system : bucket | std::views::values) {
-                system->onPause(scene);
+            for (const auto& entry : bucket | std::views::values) {
+                entry.system->onPause(scene);
             }
         }
     }
@@ -82,26 +123,114 @@ public:
     void onResume(Scene& scene) const
     {
         for (const auto& bucket : m_systems) {
-            for (const auto& system : bucket | std::views::values) {
-                system->onResume(scene);
+            for (const auto& entry : bucket | std::views::values) {
+                entry.system->onResume(scene);
             }
         }
     }
 
 private:
+    struct SystemEntry
+    {
+        std::unique_ptr<System> system;
+        /// @brief The tick the onUpdate() of this system last ran at.
+        Tick lastUpdate = 0;
+        /// @brief The tick the onRender() of this system last ran at.
+        Tick lastRender = 0;
+        SystemAccess access{ };
+    };
+
+    /// @brief A group of systems of the same phase that do not conflict with each other.
+    using SystemBatch = std::vector<SystemEntry*>;
+
+    /// @brief Runs fn on all systems, phase by phase and batch by batch, with the systems of a
+    /// batch running as jobs. All systems of a batch stamp their changes with the same tick, which
+    /// advances once the batch is done. Recorded commands are played back after each phase.
+    /// lastRun selects the last run tick of the pass that is running.
+    template <typename Fn>
+    void runAll(
+        Scene& scene,
+        SceneTicks& ticks,
+        JobSystem& jobs,
+        const std::span<CommandBuffer> commands,
+        Tick SystemEntry::* lastRun,
+        Fn&& fn
+    )
+    {
+        if (m_scheduleDirty) { buildSchedule(); }
+
+        for (const auto& batches : m_schedule) {
+            for (const SystemBatch& batch : batches) {
+                jobs.run(batch.size(), [&](const size_t i) {
+                    run(*batch[i], batch[i]->*lastRun, ticks, fn);
+                });
+                ticks.current++;
+            }
+            for (CommandBuffer& buffer : commands) { buffer.playback(scene); }
+        }
+    }
+
+    /// @brief Runs fn on the given system, exposing the given last run tick through
+    /// SceneTicks::lastRun and advancing it afterwards.
+    template <typename Fn>
+    static void run(SystemEntry& entry, Tick& lastRun, const SceneTicks& ticks, Fn& fn)
+    {
+        const Tick previous = SceneTicks::lastRun;
+        SceneTicks::lastRun = lastRun;
+        fn(*entry.system);
+        lastRun             = ticks.current;
+        SceneTicks::lastRun = previous;
+    }
+
+    /// @brief Splits the systems of each phase into batches by greedily coloring their conflict
+    /// graph, each system is placed into the first batch it does not conflict with.
+    void buildSchedule()
+    {
+        for (size_t phase = 0; phase < SYSTEM_PHASE_MAX; phase++) {
+            auto& batches = m_schedule[phase];
+            batches.clear();
+
+            for (auto& entry : m_systems[phase] | std::views::values) {
+                const auto fits = [&](const SystemBatch& batch) {
+                    return std::ranges::none_of(batch, [&](const SystemEntry* other) {
+                        return entry.access.conflicts(other->access);
+                    });
+                };
+
+                const auto batch = std::ranges::find_if(batches, fits);
+                if (batch != batches.end()) {
+                    batch->push_back(&entry);
+                } else {
+                    batches.push_back(SystemBatch{ &entry });
+                }
+            }
+        }
+        m_scheduleDirty = false;
+    }
+
+    /// @brief Returns the unique index of system type T, assigned the first time T is used.
     template <typename T>
-    [[nodiscard]] std::type_index index() const
+    [[nodiscard]] static size_t index()
     {
-        return std::type_index(typeid(T));
+        static const size_t index = s_nextIndex.fetch_add(1, std::memory_order_relaxed);
+        return index;
     }
 
-    using SystemBucket = std::unordered_map<std::type_index, std::unique_ptr<System>>;
+    static inline std::atomic<size_t> s_nextIndex = 0;
+
+    using SystemBucket = std::unordered_map<size_t, SystemEntry>;
 
     /// @brief All the registered systems ordered by phase
     std::array<SystemBucket, SYSTEM_PHASE_MAX> m_systems{ };
 
     /// @brief Unique type index per system type mapping to SystemPhase
-    std::unordered_map<std::type_index, SystemPhase> m_registeredSystems{ };
+    std::unordered_map<size_t, SystemPhase> m_registeredSystems{ };
+
+    /// @brief The batches of each phase, rebuilt whenever a system is registered or unregistered.
+    std::array<std::vector<SystemBatch>, SYSTEM_PHASE_MAX> m_schedule{ };
+    bool m_scheduleDirty = false;
+    /// @brief Whether onRender() has been called, from then on the render passes hold back pruning.
+    bool m_rendered = false;
 };
 
 } // namespace siren::ecs
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "ComponentMask.hpp"
+#include "EntityHandle.hpp"
+#include "Query.hpp"
+
+
+namespace secs
+{
+
+class Scene;
+
+/**
+ * @brief The persistent result of a query. Holds every entity whose ComponentMask matches the
+ * QueryMask, and is kept up to date by the EntityManager each time a mask changes, so reading it
+ * costs O(matches) instead of O(entities).
+ */
+class ViewStorage
+{
+public:
+    explicit ViewStorage(const QueryMask& query) : m_query(query) { }
+
+    /// @brief Checks if an entity with the given mask belongs to this view.
+    [[nodiscard]] bool matches(const ComponentMask& mask) const
+    {
+        return m_query.matches(mask);
+    }
+
+    /// @brief Adds or removes the entity depending on how its mask changed.
+    void update(const EntityHandle entity, const ComponentMask& before, const ComponentMask& after)
+    {
+        const bool matchedBefore = matches(before);
+        const bool matchesAfter  = matches(after);
+        if (matchedBefore == matchesAfter) { return; }
+
+        if (matchesAfter) {
+            insert(entity);
+        } else {
+            erase(entity);
+        }
+    }
+
+    /// @brief Adds the entity to this view.
+    void insert(const EntityHandle entity)
+    {
+        if (entity.index() >= m_positions.size()) { m_positions.resize(entity.index() + 1); }
+        m_positions[entity.index()] = m_entities.size();
+        m_entities.push_back(entity);
+    }
+
+    /// @brief Removes the entity from this view.
+    void erase(const EntityHandle entity)
+    {
+        // swap with last and pop back
+        const size_t position                     = m_positions[entity.index()];
+        m_entities[position]                      = m_entities.back();
+        m_positions[m_entities[position].index()] = position;
+        m_entities.pop_back();
+    }
+
+    /// @brief Removes all entities from this view.
+    void clear()
+    {
+        m_entities.clear();
+    }
+
+    /// @brief Reserves room for the given amount of entities.
+    void reserve(const size_t entityCount)
+    {
+        m_entities.reserve(entityCount);
+        m_positions.reserve(entityCount);
+    }
+
+    /// @brief Releases the unused capacity of this view.
+    void shrinkToFit()
+    {
+        m_entities.shrink_to_fit();
+        m_positions.shrink_to_fit();
+    }
+
+    /// @brief Returns the query of this view.
+    [[nodiscard]] const QueryMask& query() const { return m_query; }
+
+    /// @brief Returns the amount of entities in this view.
+    [[nodiscard]] size_t size() const { return m_entities.size(); }
+
+    /// @brief Returns all entities in this view.
+    [[nodiscard]] std::span<const EntityHandle> entities() const { return m_entities; }
+
+private:
+    QueryMask m_query{ };
+    /// @brief The dense list of matching entities.
+    std::vector<EntityHandle> m_entities{ };
+    /// @brief Position of each entity index inside m_entities. Only valid for matching entities.
+    std::vector<size_t> m_positions{ };
+};
+
+/**
+ * @brief A typed handle to a ViewStorage, obtained through Scene::view(). Views are registered
+ * once and then maintained incrementally, so they are cheap to keep around and iterate every frame.
+ */
+template <typename... Terms>
+class View
+{
+public:
+    View(const ViewStorage& storage, const Scene& scene) : m_storage(&storage), m_scene(&scene) { }
+
+    /// @brief Returns the amount of matching entities without iterating them.
+    [[nodiscard]] size_t size() const { return m_storage->size(); }
+
+    /// @brief Checks if no entity matches this view.
+    [[nodiscard]] bool empty() const { return m_storage->size() == 0; }
+
+    /// @brief Returns all matching entities.
+    [[nodiscard]] std::span<const EntityHandle> entities() const { return m_storage->entities(); }
+
+    [[nodiscard]] auto begin() const { return entities().begin(); }
+    [[nodiscard]] auto end() const { return entities().end(); }
+
+    /// @brief Calls fn(EntityHandle, ...) for every matching entity, passing T& for each required
+    /// component and T* for each Optional<T>. Adding or removing components or entities inside fn
+    /// is not allowed.
+    template <typename Fn>
+    void each(Fn&& fn) const;
+
+private:
+    const ViewStorage* m_storage;
+    const Scene* m_scene;
+};
+
+} // namespace secs
@@ -0,0 +1,1252 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__)
+#include <csignal>
+#include <cstdlib>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "Scene.hpp"
+
+
+using namespace secs;
+
+namespace
+{
+
+struct Position
+{
+    int x = 0;
+    int y = 0;
+};
+
+struct Velocity
+{
+    float dx = 0.0f;
+    float dy = 0.0f;
+};
+
+struct Name
+{
+    std::string value{ };
+};
+
+struct Health
+{
+    int value = 100;
+};
+
+struct Frozen { };
+
+/// @brief Runs test once for every combination of storage mode and query engine.
+template <typename Fn>
+void forEachSetup(Fn&& test)
+{
+    for (const StorageMode storage : { LIST_STORAGE, ARCHETYPE_STORAGE }) {
+        for (const QueryEngine engine : { MASK_QUERY_ENGINE, BITSET_QUERY_ENGINE }) {
+            CAPTURE(storage);
+            CAPTURE(engine);
+            test(SceneProperties{ storage, 0, false, engine });
+        }
+    }
+}
+
+#if defined(__unix__)
+/// @brief Runs fn in a forked child process and checks if it aborts, as failing asserts do.
+template <typename Fn>
+bool aborts(Fn&& fn)
+{
+    const pid_t pid = fork();
+    if (pid == 0) {
+        fn();
+        std::_Exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT;
+}
+#endif
+
+} // namespace
+
+
+TEST_CASE("Components can be added, read and removed")
+{
+    forEachSetup([](const SceneProperties& properties) {
+        Scene scene{ properties };
+        const EntityHandle entity = scene.create();
+
+        scene.emplace<Position>(entity, 1, 2);
+        scene.emplace<Name>(entity, "player");
+        CHECK(scene.hasComponent<Position>(entity));
+        CHECK(scene.get<Position>(entity).y == 2);
+        CHECK(scene.get<Name>(entity).value == "player");
+
+        // emplacing an existing component keeps it
+        scene.emplace<Position>(entity, 5, 5);
+        CHECK(scene.get<Position>(entity).x == 1);
+
+        scene.remove<Position>(entity);
+        CHECK_FALSE(scene.hasComponent<Position>(entity));
+        CHECK(scene.getSafe<Position>(entity) == nullptr);
+        CHECK(scene.get<Name>(entity).value == "player");
+    });
+}
+
+TEST_CASE("Entities keep their components while moving between storages")
+{
+    forEachSetup([](const SceneProperties& properties) {
+        Scene scene{ properties };
+        std::vector<EntityHandle> entities{ };
+        // enough entities to fill several archetype chunks
+        for (int i = 0; i < 5000; i++) {
+            const EntityHandle entity = scene.create();
+            scene.emplace<Position>(entity, i, -i);
+            if (i % 2 == 0) { scene.emplace<Velocity>(entity, 1.0f, 2.0f); }
+            if (i % 3 == 0) { scene.emplace<Name>(entity, std::to_string(i)); }
+            entities.push_back(entity);
+        }
+        for (size_t i = 0; i < entities.size(); i += 4) { scene.remove<Velocity>(entities[i]); }
+        for (size_t i = 0; i < entities.size(); i += 7) { scene.destroy(entities[i]); }
+
+        for (size_t i = 0; i < entities.size(); i++) {
+            if (i % 7 == 0) {
+                CHECK_FALSE(scene.isAlive(entities[i]));
+                continue;
+            }
+            REQUIRE(scene.get<Position>(entities[i]).x == static_cast<int>(i));
+            CHECK(scene.hasComponent<Velocity>(entities[i]) == (i % 2 == 0 && i % 4 != 0));
+            if (i % 3 == 0) { CHECK(scene.get<Name>(entities[i]).value == std::to_string(i)); }
+        }
+    });
+}
+
+TEST_CASE("Stale handles do not reach reused entities")
+{
+    forEachSetup([](const SceneProperties& properties) {
+        Scene scene{ properties };
+        const EntityHandle stale = scene.create();
+        scene.emplace<Position>(stale);
+        scene.destroy(stale);
+
+        const EntityHandle reused = scene.create();
+        scene.emplace<Position>(reused, 7, 7);
+        CHECK(reused.index() == stale.index());
+        CHECK(reused != stale);
+        CHECK_FALSE(scene.isAlive(stale));
+        CHECK_FALSE(scene.hasComponent<Position>(stale));
+        CHECK(scene.getSafe<Position>(stale) == nullptr);
+
+        scene.destroy(stale);
+        CHECK(scene.isAlive(reused));
+    });
+}
+
+TEST_CASE("Queries visit every matching entity")
+{
+    forEachSetup([](const SceneProperties& properties) {
+        Scene scene{ properties };
+        for (int i = 0; i < 300; i++) {
+            const EntityHandle entity = scene.create();
+            scene.emplace<Position>(entity, i, 0);
+            if (i % 2 == 0) { scene.emplace<Velocity>(entity); }
+            if (i % 5 == 0) { scene.emplace<Health>(entity); }
+        }
+
+        CHECK(scene.getWith<Position, Velocity>().size() == 150);
+        CHECK(scene.getWith<Position, Without<Velocity>>().size() == 150);
+        CHECK(scene.getWith<AnyOf<Velocity, Health>>().size() == 180);
+
+        int visited = 0;
+        scene.each<Position, Velocity>([&](EntityHandle, Position& position, Velocity&) {
+            CHECK(position.x % 2 == 0);
+            visited++;
+        });
+        CHECK(visited == 150);
+
+        int withHealth = 0;
+        scene.each<Position, Optional<Health>>([&](EntityHandle, Position& position, Health* hp) {
+            CHECK((hp != nullptr) == (position.x % 5 == 0));
+            if (hp) { withHealth++; }
+        });
+        CHECK(withHealth == 60);
+    });
+}
+
+TEST_CASE("Views follow component changes")
+{
+    forEachSetup([](const SceneProperties& properties) {
+        Scene scene{ properties };
+        const auto view = scene.view<Position, Velocity>();
+
+        const EntityHandle entity = scene.create();
+        scene.emplace<Position>(entity);
+        CHECK(view.size() == 0);
+        scene.emplace<Velocity>(entity);
+        CHECK(view.size() == 1);
+        scene.remove<Position>(entity);
+        CHECK(view.size() == 0);
+        scene.emplace<Position>(entity);
+        scene.destroy(entity);
+        CHECK(view.size() == 0);
+    });
+}
+
+namespace
+{
+
+/// @brief Counts the changes it sees each frame, running before ChangeWriter.
+struct ChangeReader final : System
+{
+    static inline int s_changed = 0;
+    static inline int s_added   = 0;
+    static inline int s_removed = 0;
+
+    [[nodiscard]] SystemAccess getAccess() const override
+    {
+        return SystemAccess{ }.read<Position, Health>();
+    }
+
+    void onUpdate(float, Scene& scene) override
+    {
+        s_changed = static_cast<int>(scene.getWith<Changed<Position>>().size());
+        s_added   = static_cast<int>(scene.getWith<Added<Health>>().size());
+        s_removed = static_cast<int>(scene.getRemoved<Health>().size());
+    }
+
+    void onRender(Scene& scene) override { scene.getWith<Changed<Position>>(); }
+};
+
+/// @brief Changes one Position and replaces one Health every frame.
+struct ChangeWriter final : System
+{
+    static inline EntityHandle s_entity{ };
+
+    void onUpdate(float, Scene& scene) override
+    {
+        scene.patch<Position>(s_entity, [](Position& position) { position.x++; });
+        scene.remove<Health>(s_entity);
+        scene.emplace<Health>(s_entity);
+    }
+};
+
+} // namespace
+
+TEST_CASE("Changes made after a system ran are seen by its next update")
+{
+    for (const bool render : { false, true }) {
+        CAPTURE(render);
+        forEachSetup([render](const SceneProperties& properties) {
+            Scene scene{ properties };
+            for (int i = 0; i < 10; i++) { scene.emplace<Position>(scene.create()); }
+            ChangeWriter::s_entity = scene.create();
+            scene.emplace<Position>(ChangeWriter::s_entity);
+            scene.emplace<Health>(ChangeWriter::s_entity);
+
+            scene.start<ChangeReader>(LOGIC_PHASE);
+            scene.start<ChangeWriter>(SCRIPT_PHASE);
+
+            scene.onUpdate(0.0f);
+            CHECK(ChangeReader::s_changed == 11);
+            if (render) { scene.onRender(); }
+
+            for (int frame = 0; frame < 5; frame++) {
+                CAPTURE(frame);
+                scene.onUpdate(0.0f);
+                CHECK(ChangeReader::s_changed == 1);
+                CHECK(ChangeReader::s_added == 1);
+                CHECK(ChangeReader::s_removed == 1);
+                if (render) { scene.onRender(); }
+            }
+
+            scene.stop<ChangeReader>();
+            scene.stop<ChangeWriter>();
+        });
+    }
+}
+
+TEST_CASE("Removals are only logged while systems can read them")
+{
+    forEachSetup([](const SceneProperties& properties) {
+        Scene scene{ properties };
+        for (int round = 0; round < 3; round++) {
+            scene.createMany(1000, Bundle<Health>{ Health{ 1 } });
+            scene.destroyAll();
+        }
+        CHECK(scene.getRemoved<Health>().empty());
+
+        scene.start<ChangeReader>(LOGIC_PHASE);
+        scene.createMany(10, Bundle<Health>{ Health{ 1 } });
+        scene.destroyAll();
+        CHECK(scene.getRemoved<Health>().size() == 10);
+
+        // pruned once the system has seen them
+        scene.onUpdate(0.0f);
+        CHECK(ChangeReader::s_removed == 10);
+        scene.onUpdate(0.0f);
+        CHECK(scene.getRemoved<Health>().empty());
+
+        scene.createMany(10, Bundle<Health>{ Health{ 1 } });
+        scene.destroyAll();
+        scene.stop<ChangeReader>();
+        CHECK(scene.getRemoved<Health>().empty());
+    });
+}
+
+namespace
+{
+
+struct Settings
+{
+    int scale = 2;
+};
+
+struct Unused
+{
+    int value = 0;
+};
+
+/// @brief Reads Health and Settings, and only finishes once the other reader runs at the same
+/// time, or gives up after a while.
+template <int ID>
+struct ConcurrentReader final : System
+{
+    static inline std::atomic<int> s_arrived{ 0 };
+    static inline std::atomic<bool> s_metOther{ false };
+    static inline std::atomic<long> s_sum{ 0 };
+
+    [[nodiscard]] SystemAccess getAccess() const override
+    {
+        return SystemAccess{ }.read<Health, Unused>().template readSingleton<Settings>();
+    }
+
+    void onUpdate(float, Scene& scene) override
+    {
+        ConcurrentReader<0>::s_arrived++;
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (ConcurrentReader<0>::s_arrived.load() < 2
+               && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+        s_metOther = ConcurrentReader<0>::s_arrived.load() >= 2;
+
+        // read only lookups of a type without storage must not create it
+        long sum = 0;
+        for (const EntityHandle entity : scene.getWith<Health>()) {
+            CHECK(scene.getSafe<Unused>(entity) == nullptr);
+            CHECK(scene.getTicks<Unused>(entity) == nullptr);
+            sum += scene.get<Health>(entity).value * scene.getSingleton<Settings>().scale;
+        }
+        if (scene.getProperties().storage == LIST_STORAGE) {
+            CHECK(scene.storage<Unused>().size() == 0);
+        }
+        s_sum = sum;
+    }
+};
+
+/// @brief Writes Health, so it never runs together with the readers.
+struct HealthWriter final : System
+{
+    [[nodiscard]] SystemAccess getAccess() const override
+    {
+        return SystemAccess{ }.write<Health>();
+    }
+
+    void onUpdate(float, Scene& scene) override
+    {
+        CHECK(ConcurrentReader<0>::s_arrived.load() != 1);
+        scene.each<Health>([](EntityHandle, Health& health) { health.value++; });
+    }
+};
+
+} // namespace
+
+TEST_CASE("Systems with non conflicting access run concurrently")
+{
+    forEachSetup([](SceneProperties properties) {
+        properties.workerCount = 3;
+        Scene scene{ properties };
+        scene.emplaceSingleton<Settings>();
+        for (int i = 0; i < 100; i++) { scene.emplace<Health>(scene.create(), i); }
+
+        scene.start<ConcurrentReader<0>>(LOGIC_PHASE);
+        scene.start<ConcurrentReader<1>>(LOGIC_PHASE);
+        scene.start<HealthWriter>(LOGIC_PHASE);
+
+        for (int frame = 0; frame < 3; frame++) {
+            ConcurrentReader<0>::s_arrived = 0;
+            scene.onUpdate(0.0f);
+            CHECK(ConcurrentReader<0>::s_metOther);
+            CHECK(ConcurrentReader<1>::s_metOther);
+            CHECK(ConcurrentReader<0>::s_sum == ConcurrentReader<1>::s_sum);
+        }
+
+        scene.stop<ConcurrentReader<0>>();
+        scene.stop<ConcurrentReader<1>>();
+        scene.stop<HealthWriter>();
+    });
+}
+
+TEST_CASE("Singleton access is tracked apart from component access")
+{
+    const SystemAccess singletonWriter = SystemAccess{ }.writeSingleton<Health>();
+    const SystemAccess componentReader = SystemAccess{ }.read<Health>();
+    CHECK(singletonWriter.writes.none());
+    CHECK(singletonWriter.reads.none());
+    CHECK_FALSE(singletonWriter.conflicts(componentReader));
+    CHECK(singletonWriter.conflicts(SystemAccess{ }.readSingleton<Health>()));
+    CHECK(componentReader.conflicts(SystemAccess{ }.write<Health>()));
+    CHECK_FALSE(componentReader.conflicts(SystemAccess{ }.read<Health>()));
+}
+
+TEST_CASE("Parallel loops visit the same entities as sequential ones")
+{
+    forEachSetup([](SceneProperties properties) {
+        properties.workerCount = 4;
+        Scene scene{ properties };
+        for (int i = 0; i < 10000; i++) {
+            const EntityHandle entity = scene.create();
+            scene.emplace<Position>(entity, i, 1);
+            if (i % 3 != 0) { scene.emplace<Velocity>(entity, 1.0f, 0.0f); }
+        }
+
+        int64_t sequential = 0;
+        size_t visited     = 0;
+        scene.each<Position, Velocity>([&](EntityHandle, Position& position, Velocity&) {
+            sequential += position.x;
+            visited++;
+        });
+
+        std::atomic<int64_t> parallel       = 0;
+        std::atomic<size_t> parallelVisited = 0;
+        scene.parEach<Position, Velocity>(
+            [&](EntityHandle, Position& position, Velocity&) {
+                parallel += position.x;
+                parallelVisited++;
+            },
+            64
+        );
+        CHECK(visited == 6666);
+        CHECK(parallelVisited == visited);
+        CHECK(parallel == sequential);
+    });
+}
+
+#if defined(__unix__)
+TEST_CASE("Structural changes during parallel loops are asserted against")
+{
+    for (const StorageMode storage : { LIST_STORAGE, ARCHETYPE_STORAGE }) {
+        CAPTURE(storage);
+        const auto iterate = [storage](const auto& change) {
+            Scene scene{ SceneProperties{ storage, 2 } };
+            for (int i = 0; i < 1000; i++) { scene.emplace<Position>(scene.create(), i, i); }
+            scene.parEach<Position>([&](const EntityHandle entity, Position&) {
+                change(scene, entity);
+            });
+        };
+
+        CHECK(aborts([&] { iterate([](Scene& scene, EntityHandle) { scene.create(); }); }));
+        CHECK(aborts([&] {
+            iterate([](Scene& scene, const EntityHandle entity) { scene.destroy(entity); });
+        }));
+        CHECK(aborts([&] {
+            iterate([](Scene& scene, const EntityHandle entity) { scene.emplace<Health>(entity); });
+        }));
+        CHECK(aborts([&] {
+            iterate([](Scene& scene, const EntityHandle entity) {
+                scene.remove<Position>(entity);
+            });
+        }));
+
+        // reading and writing the components being iterated is fine
+        CHECK_FALSE(aborts([&] {
+            iterate([](Scene& scene, const EntityHandle entity) {
+                scene.get<Position>(entity).y = 0;
+            });
+        }));
+    }
+}
+#endif
+
+TEST_CASE("Job systems run every job once before returning")
+{
+    JobSystem jobs{ 4 };
+    std::vector<std::atomic<int>> calls(10000);
+    jobs.run(calls.size(), [&](const size_t i) { calls[i]++; });
+    CHECK(std::ranges::all_of(calls, [](const std::atomic<int>& count) { return count == 1; }));
+
+    std::atomic<size_t> covered = 0;
+    std::atomic<bool> tooLong   = false;
+    jobs.parallelFor(10000, 64, [&](const size_t begin, const size_t end) {
+        if (end - begin > 64) { tooLong = true; }
+        for (size_t i = begin; i < end; i++) { calls[i]++; }
+        covered += end - begin;
+    });
+    CHECK(covered == 10000);
+    CHECK_FALSE(tooLong);
+    CHECK(std::ranges::all_of(calls, [](const std::atomic<int>& count) { return count == 2; }));
+}
+
+TEST_CASE("Job systems allow nested jobs and callers from other threads")
+{
+    JobSystem jobs{ 4 };
+
+    // every outer job splits its own loop into more jobs, while running on a worker or the caller
+    std::atomic<size_t> sum        = 0;
+    std::atomic<bool> invalidIndex = false;
+    jobs.run(16, [&](size_t) {
+        if (jobs.threadIndex() > jobs.workerCount()) { invalidIndex = true; }
+        jobs.parallelFor(1000, 10, [&](const size_t begin, const size_t end) {
+            for (size_t i = begin; i < end; i++) { sum += i; }
+        });
+    });
+    CHECK(sum == 16 * (999 * 1000 / 2));
+    CHECK_FALSE(invalidIndex);
+
+    // threads that are not workers share queue 0, and may submit at the same time
+    std::vector<size_t> outsideIndices(3);
+    std::atomic<size_t> outsideSum = 0;
+    std::vector<std::thread> threads{ };
+    for (size_t t = 0; t < outsideIndices.size(); t++) {
+        threads.emplace_back([&, t] {
+            outsideIndices[t] = jobs.threadIndex();
+            jobs.run(1000, [&](const size_t i) { outsideSum += i; });
+        });
+    }
+    for (std::thread& thread : threads) { thread.join(); }
+    CHECK(jobs.threadIndex() == 0);
+    CHECK(std::ranges::all_of(outsideIndices, [](const size_t index) { return index == 0; }));
+    CHECK(outsideSum == 3 * (999 * 1000 / 2));
+}
+
+TEST_CASE("Job systems shut down cleanly without starting their threads")
+{
+    // never used
+    { JobSystem jobs{ 4 }; }
+
+    // ranges of at most one grain run inline without starting the workers
+    {
+        JobSystem jobs{ 4 };
+        size_t calls = 0;
+        jobs.parallelFor(10, 64, [&](const size_t begin, const size_t end) {
+            CHECK(begin == 0);
+            CHECK(end == 10);
+            calls++;
+        });
+        CHECK(calls == 1);
+    }
+
+    // without workers everything runs on the calling thread
+    JobSystem jobs{ 0 };
+    const std::thread::id caller = std::this_thread::get_id();
+    bool elsewhere               = false;
+    jobs.run(100, [&](size_t) { elsewhere |= std::this_thread::get_id() != caller; });
+    CHECK_FALSE(elsewhere);
+}
+
+namespace
+{
+
+struct Particle
+{
+    float x = 0.0f;
+    float y = 0.0f;
+    int id  = 0;
+};
+
+struct Spark
+{
+    float x = 0.0f;
+    float y = 0.0f;
+    int id  = 0;
+};
+
+/// @brief Adds, reads, writes and removes components of a struct of arrays vector.
+template <typename T, typename Vector>
+void checkLayoutVector(Vector& vector)
+{
+    for (int i = 0; i < 10; i++) {
+        vector.emplaceBack(static_cast<float>(i), static_cast<float>(-i), i);
+    }
+    REQUIRE(vector.size() == 10);
+    CHECK(vector[3].x == 3.0f);
+    CHECK(vector[3].y == -3.0f);
+    CHECK(vector.back().id == 9);
+
+    // writes through a Ref reach the stored fields
+    vector[4].x = 40.0f;
+    CHECK(vector[4].x == 40.0f);
+    CHECK(vector[4].id == 4);
+
+    // the last component fills the hole, all fields move together
+    vector.swapRemove(2);
+    REQUIRE(vector.size() == 9);
+    CHECK(vector[2].id == 9);
+    CHECK(vector[2].x == 9.0f);
+    CHECK(vector[2].y == -9.0f);
+    vector.swapRemove(vector.size() - 1);
+    CHECK(vector.size() == 8);
+    CHECK(vector.back().id == 7);
+
+    vector.appendCopies(4, 3);
+    REQUIRE(vector.size() == 11);
+    for (size_t i = 8; i < 11; i++) {
+        CHECK(vector[i].x == 40.0f);
+        CHECK(vector[i].id == 4);
+    }
+
+    vector.clear();
+    CHECK(vector.size() == 0);
+    vector.emplaceBack(1.0f, 2.0f, 3);
+    CHECK(vector[0].id == 3);
+}
+
+} // namespace
+
+template <>
+struct secs::ComponentLayout<Particle>
+{
+    struct Ref
+    {
+        float& x;
+        float& y;
+        int& id;
+    };
+};
+
+template <>
+struct secs::ComponentLayout<Spark>
+{
+    struct Ref
+    {
+        float& x;
+        float& y;
+        int& id;
+    };
+
+    static constexpr size_t LANES = 4;
+};
+
+TEST_CASE("Struct of arrays components round trip through their fields")
+{
+    static_assert(std::is_same_v<DenseStorage<Particle>::Type, SoAVector<Particle>>);
+    static_assert(std::is_same_v<DenseStorage<Spark>::Type, AoSoAVector<Spark, 4>>);
+
+    SUBCASE("One column per field")
+    {
+        SoAVector<Particle> particles{ };
+        checkLayoutVector<Particle>(particles);
+        CHECK(particles.column<2>()[0] == 3);
+    }
+    SUBCASE("Blocks of lanes")
+    {
+        AoSoAVector<Spark, 4> sparks{ };
+        checkLayoutVector<Spark>(sparks);
+    }
+    SUBCASE("Through the scene")
+    {
+        forEachSetup([](const SceneProperties& properties) {
+            Scene scene{ properties };
+            std::vector<EntityHandle> entities{ };
+            for (int i = 0; i < 100; i++) {
+                const EntityHandle entity = scene.create();
+                scene.emplace<Particle>(entity, static_cast<float>(i), 0.0f, i);
+                scene.emplace<Spark>(entity, 0.0f, static_cast<float>(i), i);
+                entities.push_back(entity);
+            }
+            for (size_t i = 0; i < entities.size(); i += 3) { scene.remove<Particle>(entities[i]); }
+            for (size_t i = 0; i < entities.size(); i += 5) { scene.remove<Spark>(entities[i]); }
+
+            scene.each<Particle, Spark>([](EntityHandle, auto particle, auto spark) {
+                particle.x += 0.5f;
+                spark.y += 0.5f;
+            });
+            for (size_t i = 0; i < entities.size(); i++) {
+                const int id = static_cast<int>(i);
+                if (i % 3 != 0) {
+                    const ComponentRef<Particle> particle = scene.get<Particle>(entities[i]);
+                    CHECK(particle.id == id);
+                    CHECK(particle.x == static_cast<float>(i) + (i % 5 != 0 ? 0.5f : 0.0f));
+                }
+                if (i % 5 != 0) {
+                    const ComponentRef<Spark> spark = scene.get<Spark>(entities[i]);
+                    CHECK(spark.id == id);
+                    CHECK(spark.y == static_cast<float>(i) + (i % 3 != 0 ? 0.5f : 0.0f));
+                }
+            }
+        });
+    }
+}
+
+TEST_CASE("Component storage exposes aligned and padded arrays")
+{
+    const auto aligned = [](const void* data) {
+        return reinterpret_cast<uintptr_t>(data) % STORAGE_ALIGNMENT == 0;
+    };
+
+    for (const QueryEngine engine : { MASK_QUERY_ENGINE, BITSET_QUERY_ENGINE }) {
+        CAPTURE(engine);
+        Scene scene{ SceneProperties{ LIST_STORAGE, 0, false, engine } };
+        CHECK(scene.storage<Position>().data() == nullptr);
+        CHECK(scene.storage<Position>().size() == 0);
+        CHECK(scene.storage<Particle>().field<0>().empty());
+
+        std::vector<EntityHandle> entities{ };
+        for (int i = 0; i < 101; i++) {
+            const EntityHandle entity = scene.create();
+            scene.emplace<Position>(entity, i, i);
+            scene.emplace<Particle>(entity, static_cast<float>(i), 0.0f, i);
+            entities.push_back(entity);
+        }
+        for (size_t i = 0; i < entities.size(); i += 10) { scene.destroy(entities[i]); }
+
+        const ComponentStorage<Position> positions = scene.storage<Position>();
+        REQUIRE(positions.size() == 90);
+        CHECK(positions.span().size() == 90);
+        CHECK(aligned(positions.data()));
+        // padded to the next multiple of the alignment, no further
+        const size_t paddedBytes = positions.paddedSize() * sizeof(Position);
+        CHECK(positions.paddedSize() >= positions.size());
+        CHECK(paddedBytes % STORAGE_ALIGNMENT == 0);
+        CHECK(paddedBytes < positions.size() * sizeof(Position) + STORAGE_ALIGNMENT);
+        for (size_t i = 0; i < positions.size(); i++) {
+            CHECK(scene.get<Position>(positions.entities()[i]).x == positions.span()[i].x);
+        }
+
+        // struct of arrays components expose every field as its own aligned array
+        const ComponentStorage<Particle> particles = scene.storage<Particle>();
+        const std::span<float> xs = particles.field<0>();
+        const std::span<int> ids  = particles.field<2>();
+        REQUIRE(xs.size() == 90);
+        REQUIRE(ids.size() == 90);
+        CHECK(aligned(xs.data()));
+        CHECK(aligned(ids.data()));
+        for (size_t i = 0; i < particles.size(); i++) {
+            const ComponentRef<Particle> particle = scene.get<Particle>(particles.entities()[i]);
+            CHECK(particle.id == ids[i]);
+            CHECK(particle.x == xs[i]);
+        }
+    }
+
+#if defined(__unix__)
+    CHECK(aborts([] {
+        Scene scene{ SceneProperties{ ARCHETYPE_STORAGE, 0 } };
+        scene.emplace<Position>(scene.create());
+        static_cast<void>(scene.storage<Position>());
+    }));
+#endif
+}
+
+namespace
+{
+
+struct Waypoint
+{
+    std::string name{ };
+    int order = 0;
+};
+
+} // namespace
+
+template <>
+struct secs::ComponentLayout<Waypoint>
+{
+    static constexpr size_t PAGE_SIZE = 64;
+};
+
+TEST_CASE("Paged components stay in place while more are added")
+{
+    static_assert(std::is_same_v<DenseStorage<Waypoint>::Type, PagedVector<Waypoint, 64>>);
+
+    PagedVector<Waypoint, 64> waypoints{ };
+    const Waypoint* first = &waypoints.emplaceBack(Waypoint{ "first", 0 });
+    const Waypoint* last  = first;
+    for (int i = 1; i < 10000; i++) { last = &waypoints.emplaceBack(Waypoint{ "", i }); }
+    CHECK(&waypoints[0] == first);
+    CHECK(&waypoints[9999] == last);
+    CHECK(first->name == "first");
+    CHECK(last->order == 9999);
+    CHECK(waypoints.pageCount() == 10000 / 64 + 1);
+
+    // the same holds for references handed out by the scene
+    Scene scene{ SceneProperties{ LIST_STORAGE, 0 } };
+    const EntityHandle held = scene.create();
+    Waypoint& waypoint      = scene.emplace<Waypoint>(held, Waypoint{ "held", -1 });
+    for (int i = 0; i < 10000; i++) { scene.emplace<Waypoint>(scene.create(), Waypoint{ "", i }); }
+    CHECK(&scene.get<Waypoint>(held) == &waypoint);
+    CHECK(waypoint.name == "held");
+    CHECK(waypoint.order == -1);
+}
+
+namespace
+{
+
+/// @brief Holds its value on the heap and counts how often it is move constructed and destroyed.
+template <int ID>
+struct Counted
+{
+    static inline int s_moves    = 0;
+    static inline int s_destroys = 0;
+
+    std::unique_ptr<int> value{ };
+
+    explicit Counted(const int initial) : value(std::make_unique<int>(initial)) { }
+    Counted(Counted&& other) noexcept : value(std::move(other.value)) { s_moves++; }
+    Counted& operator=(Counted&& other) noexcept = default;
+    ~Counted() { s_destroys++; }
+
+    static void reset()
+    {
+        s_moves    = 0;
+        s_destroys = 0;
+    }
+};
+
+using Moved     = Counted<0>;
+using Relocated = Counted<1>;
+
+} // namespace
+
+template <>
+struct secs::IsTriviallyRelocatable<Relocated> : std::true_type { };
+
+TEST_CASE("Components are relocated by memcpy only if they opted in")
+{
+    static_assert(!isTriviallyRelocatable<std::string>);
+    static_assert(!isTriviallyRelocatable<Moved>);
+    static_assert(isTriviallyRelocatable<Relocated>);
+    static_assert(isTriviallyRelocatable<Position>);
+
+    // short strings point into themselves, so they have to be moved to stay valid
+    ComponentVector<std::string> strings{ };
+    for (int i = 0; i < 100; i++) { strings.emplaceBack(std::to_string(i)); }
+    strings.reserve(10000);
+    strings.swapRemove(0);
+    CHECK(strings[0] == "99");
+    CHECK(strings[50] == "50");
+
+    SUBCASE("Types that did not opt in are moved and destroyed")
+    {
+        Moved::reset();
+        ComponentVector<Moved> components{ };
+        components.reserve(10);
+        for (int i = 0; i < 10; i++) { components.emplaceBack(i); }
+        Moved::reset();
+
+        components.reserve(1000);
+        CHECK(Moved::s_moves == 10);
+        CHECK(Moved::s_destroys == 10);
+        CHECK(*components[9].value == 9);
+
+        alignas(Moved) std::byte source[sizeof(Moved)];
+        alignas(Moved) std::byte target[sizeof(Moved)];
+        new(source) Moved(42);
+        Moved::reset();
+        ComponentInfo::of<Moved>().relocate(target, source);
+        CHECK(Moved::s_moves == 1);
+        CHECK(Moved::s_destroys == 1);
+        Moved* relocated = std::launder(reinterpret_cast<Moved*>(target));
+        CHECK(*relocated->value == 42);
+        std::destroy_at(relocated);
+    }
+    SUBCASE("Types that opted in are copied byte wise")
+    {
+        Relocated::reset();
+        ComponentVector<Relocated> components{ };
+        components.reserve(10);
+        for (int i = 0; i < 10; i++) { components.emplaceBack(i); }
+        Relocated::reset();
+
+        components.reserve(1000);
+        components.swapRemove(0);
+        CHECK(Relocated::s_moves == 0);
+        CHECK(Relocated::s_destroys == 1);
+        CHECK(*components[0].value == 9);
+        CHECK(*components[8].value == 8);
+
+        PagedVector<Relocated, 4> paged{ };
+        for (int i = 0; i < 10; i++) { paged.emplaceBack(i); }
+        Relocated::reset();
+        paged.swapRemove(0);
+        CHECK(Relocated::s_moves == 0);
+        CHECK(*paged[0].value == 9);
+
+        alignas(Relocated) std::byte source[sizeof(Relocated)];
+        alignas(Relocated) std::byte target[sizeof(Relocated)];
+        new(source) Relocated(42);
+        Relocated::reset();
+        ComponentInfo::of<Relocated>().relocate(target, source);
+        CHECK(Relocated::s_moves == 0);
+        CHECK(Relocated::s_destroys == 0);
+        Relocated* relocated = std::launder(reinterpret_cast<Relocated*>(target));
+        CHECK(*relocated->value == 42);
+        std::destroy_at(relocated);
+    }
+}
+
+TEST_CASE("Creating entities in many small batches stays linear")
+{
+    forEachSetup([](const SceneProperties& properties) {
+        Scene scene{ properties };
+        constexpr int COUNT = 20000;
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < COUNT; i++) {
+            scene.createMany(1, Bundle<Position, Health>{ Position{ i, i }, Health{ i } });
+        }
+        // reallocating on every batch takes seconds here
+        CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(1));
+
+        const std::vector<EntityHandle> entities = scene.getWith<Position, Health>();
+        CHECK(entities.size() == COUNT);
+        for (const EntityHandle entity : entities) {
+            CHECK(scene.get<Position>(entity).x == scene.get<Health>(entity).value);
+        }
+    });
+}
+
+TEST_CASE("Cloning entities one at a time stays linear")
+{
+    forEachSetup([](const SceneProperties& properties) {
+        Scene scene{ properties };
+        constexpr int COUNT = 20000;
+        const EntityHandle prefab = scene.create();
+        scene.emplace<Position>(prefab, 1, 2);
+        scene.emplace<Name>(prefab, "prefab");
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < COUNT; i++) { scene.clone(prefab); }
+        CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(1));
+
+        const std::vector<EntityHandle> entities = scene.getWith<Position, Name>();
+        CHECK(entities.size() == COUNT + 1);
+        for (const EntityHandle entity : entities) {
+            CHECK(scene.get<Position>(entity).y == 2);
+            CHECK(scene.get<Name>(entity).value == "prefab");
+        }
+    });
+}
+
+TEST_CASE("Tags live only in the entity masks")
+{
+    forEachSetup([](const SceneProperties& properties) {
+        Scene scene{ properties };
+        const EntityHandle frozen = scene.create();
+        const EntityHandle other  = scene.create();
+        scene.emplace<Position>(frozen, 1, 1);
+        scene.emplace<Position>(other, 2, 2);
+
+        CHECK(&scene.emplace<Frozen>(frozen) == &tagInstance<Frozen>());
+        CHECK(scene.hasComponent<Frozen>(frozen));
+        CHECK_FALSE(scene.hasComponent<Frozen>(other));
+        CHECK(&scene.get<Frozen>(frozen) == &tagInstance<Frozen>());
+        CHECK(scene.getSafe<Frozen>(other) == nullptr);
+        CHECK(scene.getTicks<Frozen>(frozen) == nullptr);
+        scene.markChanged<Frozen>(frozen);
+
+        const std::vector<EntityHandle> entities = scene.getWith<Position, Frozen>();
+        REQUIRE(entities.size() == 1);
+        CHECK(entities.front() == frozen);
+
+        scene.remove<Frozen>(frozen);
+        CHECK_FALSE(scene.hasComponent<Frozen>(frozen));
+        CHECK(scene.getSafe<Frozen>(frozen) == nullptr);
+        CHECK(scene.get<Position>(frozen).x == 1);
+    });
+}
+
+TEST_CASE("Destroying entities in bulk keeps the remaining ones intact")
+{
+    forEachSetup([](const SceneProperties& properties) {
+        Scene scene{ properties };
+        const auto view = scene.view<Position, Health>();
+        std::vector<EntityHandle> created{ };
+        for (int i = 0; i < 1000; i++) {
+            const EntityHandle entity = scene.create();
+            scene.emplace<Position>(entity, i, i);
+            scene.emplace<Health>(entity, i);
+            if (i % 3 == 0) { scene.emplace<Velocity>(entity, 1.0f, 1.0f); }
+            created.push_back(entity);
+        }
+
+        scene.destroyWith<Velocity>();
+        CHECK(scene.getAll().size() == 666);
+        CHECK(view.size() == 666);
+        CHECK(scene.getWith<Velocity>().empty());
+        for (int i = 0; i < 1000; i++) {
+            const EntityHandle entity = created[i];
+            CHECK(scene.isAlive(entity) == (i % 3 != 0));
+            if (!scene.isAlive(entity)) { continue; }
+            CHECK(scene.get<Position>(entity).x == i);
+            CHECK(scene.get<Health>(entity).value == i);
+        }
+        for (const EntityHandle entity : view) {
+            CHECK(scene.get<Position>(entity).x == scene.get<Health>(entity).value);
+        }
+        size_t visited = 0;
+        scene.each<Position, Health>([&](EntityHandle entity, Position& position, Health& health) {
+            CHECK(scene.isAlive(entity));
+            CHECK(position.x == health.value);
+            visited++;
+        });
+        CHECK(visited == 666);
+
+        // freed indices are handed out again without clashing with the remaining entities
+        const EntityHandle reused = scene.create();
+        scene.emplace<Health>(reused, -1);
+        CHECK(scene.getWith<Health>().size() == 667);
+        CHECK(scene.get<Health>(created[1]).value == 1);
+    });
+}
+
+TEST_CASE("Clearing a component type keeps the other components of every entity")
+{
+    forEachSetup([](const SceneProperties& properties) {
+        Scene scene{ properties };
+        const auto healthView   = scene.view<Position, Health>();
+        const auto positionView = scene.view<Position>();
+        std::vector<EntityHandle> created{ };
+        for (int i = 0; i < 3000; i++) {
+            const EntityHandle entity = scene.create();
+            scene.emplace<Position>(entity, i, i);
+            if (i % 2 == 0) { scene.emplace<Health>(entity, i); }
+            if (i % 3 == 0) { scene.emplace<Name>(entity, std::to_string(i)); }
+            created.push_back(entity);
+        }
+
+        scene.clear<Health>();
+        CHECK(scene.getWith<Health>().empty());
+        CHECK(healthView.size() == 0);
+        CHECK(positionView.size() == 3000);
+        CHECK(scene.getWith<Position, Name>().size() == 1000);
+        for (int i = 0; i < 3000; i++) {
+            const EntityHandle entity = created[i];
+            CHECK_FALSE(scene.hasComponent<Health>(entity));
+            CHECK(scene.get<Position>(entity).x == i);
+            if (i % 3 == 0) { CHECK(scene.get<Name>(entity).value == std::to_string(i)); }
+        }
+
+        // the component type can be added again afterwards
+        scene.emplace<Health>(created[7], 7);
+        CHECK(scene.getWith<Health>().size() == 1);
+        CHECK(healthView.size() == 1);
+
+        scene.destroyAll();
+        CHECK(scene.getAll().empty());
+        CHECK(positionView.size() == 0);
+        CHECK(scene.getWith<Position>().empty());
+        CHECK_FALSE(scene.isAlive(created.front()));
+
+        const EntityHandle entity = scene.create();
+        scene.emplace<Position>(entity, 1, 2);
+        CHECK(scene.getWith<Position>().size() == 1);
+        CHECK(positionView.size() == 1);
+        CHECK(scene.get<Position>(entity).y == 2);
+    });
+}
+
+TEST_CASE("Reserved capacity is kept until shrinking to fit")
+{
+    const size_t index = ComponentBitMap::getBitIndex<Position>();
+    ComponentMask mask{ };
+    mask.set(index);
+    std::array<ComponentInfo, MAX_COMPONENTS> infos{ };
+    infos[index] = ComponentInfo::of<Position>();
+
+    Archetype archetype{ mask, infos };
+    const size_t rows = archetype.capacity() * 4;
+    archetype.reserve(rows);
+    CHECK(archetype.chunkCount() == 4);
+    for (size_t i = 0; i < rows; i++) {
+        const size_t row = archetype.push(EntityHandle{ static_cast<EntityIndex>(i), 1 });
+        new(archetype.component(index, row)) Position{ static_cast<int>(i), 0 };
+    }
+    CHECK(archetype.chunkCount() == 4);
+
+    // removing rows keeps the chunks, the freed rows are reused without allocating
+    while (archetype.size() > archetype.capacity()) { archetype.destroy(0); }
+    CHECK(archetype.chunkCount() == 4);
+    archetype.clear();
+    CHECK(archetype.chunkCount() == 4);
+    archetype.shrinkToFit();
+    CHECK(archetype.chunkCount() == 0);
+
+    EntityBitset bitset{ };
+    bitset.reserve(10000);
+    const size_t capacity = bitset.capacity();
+    CHECK(capacity >= 10000);
+    for (EntityIndex i = 0; i < 10000; i += 7) { bitset.set(i); }
+    CHECK(bitset.capacity() == capacity);
+    CHECK(bitset.test(9996));
+
+    forEachSetup([](const SceneProperties& properties) {
+        Scene scene{ properties };
+        scene.reserve(5000);
+        scene.reserve<Position, Health>(5000);
+        scene.createMany(5000, Bundle<Position, Health>{ Position{ 1, 1 }, Health{ 2 } });
+        CHECK(scene.getWith<Position, Health>().size() == 5000);
+
+        scene.destroyAll();
+        scene.shrinkToFit();
+        CHECK(scene.getWith<Position>().empty());
+        scene.createMany(10, Bundle<Position>{ Position{ 3, 3 } });
+        CHECK(scene.getWith<Position>().size() == 10);
+        CHECK(scene.getWith<Position, Health>().empty());
+    });
+}
+
+TEST_CASE("Bitset queries from several threads at once")
+{
+    Scene scene{ SceneProperties{ LIST_STORAGE, 0, false, BITSET_QUERY_ENGINE } };
+    for (int i = 0; i < 1000; i++) {
+        const EntityHandle entity = scene.create();
+        scene.emplace<Position>(entity, i, i);
+        if (i % 2 == 0) { scene.emplace<Health>(entity, i); }
+        if (i % 5 == 0) { scene.emplace<Velocity>(entity, 1.0f, 1.0f); }
+    }
+
+    std::atomic<int> mismatches = 0;
+    std::vector<std::thread> threads{ };
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&scene, &mismatches] {
+            for (int i = 0; i < 200; i++) {
+                if (scene.getWith<Position, Health>().size() != 500) { mismatches++; }
+                if (scene.getWith<Health, Without<Velocity>>().size() != 400) { mismatches++; }
+            }
+        });
+    }
+    for (std::thread& thread : threads) { thread.join(); }
+    CHECK(mismatches == 0);
+}
+
+TEST_CASE("Command buffers apply recorded changes on flush")
+{
+    forEachSetup([](const SceneProperties& properties) {
+        Scene scene{ properties };
+        const EntityHandle existing = scene.create();
+        scene.emplace<Position>(existing, 1, 1);
+        const EntityHandle doomed = scene.create();
+
+        CommandBuffer& commands = scene.getCommandBuffer();
+        const EntityHandle created = commands.create();
+        commands.emplace<Position>(created, 2, 2);
+        commands.emplace<Name>(created, "created");
+        commands.emplace<Velocity>(existing, 1.0f, 0.0f);
+        commands.remove<Position>(existing);
+        commands.emplace<Health>(doomed, 5);
+        commands.destroy(doomed);
+
+        // nothing is applied before the flush
+        CHECK_FALSE(commands.empty());
+        CHECK(scene.getAll().size() == 2);
+        CHECK(scene.hasComponent<Position>(existing));
+        CHECK_FALSE(scene.isAlive(created));
+
+        scene.flushCommands();
+        CHECK(commands.empty());
+        CHECK(scene.getAll().size() == 2);
+        CHECK_FALSE(scene.isAlive(doomed));
+        CHECK_FALSE(scene.hasComponent<Position>(existing));
+        CHECK(scene.hasComponent<Velocity>(existing));
+
+        // the placeholder is replaced with a real entity
+        const std::vector<EntityHandle> named = scene.getWith<Position, Name>();
+        REQUIRE(named.size() == 1);
+        CHECK(named.front() != created);
+        CHECK(scene.get<Position>(named.front()).x == 2);
+        CHECK(scene.get<Name>(named.front()).value == "created");
+    });
+}
+
+TEST_CASE("Command buffers keep the order of commands on the same component")
+{
+    forEachSetup([](const SceneProperties& properties) {
+        Scene scene{ properties };
+        const EntityHandle entity = scene.create();
+        scene.emplace<Health>(entity, 1);
+        CommandBuffer& commands = scene.getCommandBuffer();
+
+        commands.remove<Health>(entity);
+        commands.emplace<Health>(entity, 42);
+        scene.flushCommands();
+        REQUIRE(scene.hasComponent<Health>(entity));
+        CHECK(scene.get<Health>(entity).value == 42);
+
+        // emplacing a component the entity already has keeps it, the removal then takes it away
+        commands.emplace<Health>(entity, 7);
+        commands.remove<Health>(entity);
+        scene.flushCommands();
+        CHECK_FALSE(scene.hasComponent<Health>(entity));
+
+        const EntityHandle created = commands.create();
+        commands.emplace<Health>(created, 1);
+        commands.remove<Health>(created);
+        commands.emplace<Health>(created, 2);
+        scene.flushCommands();
+        const std::vector<EntityHandle> entities = scene.getWith<Health>();
+        REQUIRE(entities.size() == 1);
+        CHECK(scene.get<Health>(entities.front()).value == 2);
+    });
+}
+
+#if SECS_MAX_COMPONENTS >= 128
+namespace
+{
+
+template <size_t N>
+struct Filler
+{
+    int value = 0;
+};
+
+/// @brief Registers Filler<0> to Filler<N - 1>, pushing later components past the first mask word.
+template <size_t... Ns>
+void registerFillers(std::index_sequence<Ns...>)
+{
+    (ComponentBitMap::getBitIndex<Filler<Ns>>(), ...);
+}
+
+} // namespace
+
+TEST_CASE("Queries match components beyond the first mask word")
+{
+    registerFillers(std::make_index_sequence<70>{ });
+    REQUIRE(ComponentBitMap::getBitIndex<Filler<69>>() >= 64);
+
+    forEachSetup([](const SceneProperties& properties) {
+        Scene scene{ properties };
+        // not a multiple of four, so the scan has a tail after its four wide steps
+        for (int i = 0; i < 101; i++) {
+            const EntityHandle entity = scene.create();
+            scene.emplace<Position>(entity, i, i);
+            if (i % 2 == 0) { scene.emplace<Filler<69>>(entity, i); }
+            if (i % 3 == 0) { scene.emplace<Filler<68>>(entity, i); }
+        }
+
+        CHECK(scene.getWith<Filler<69>>().size() == 51);
+        CHECK(scene.getWith<Position, Filler<69>, Filler<68>>().size() == 17);
+        CHECK(scene.getWith<Position, Without<Filler<69>>>().size() == 50);
+        CHECK(scene.getWith<AnyOf<Filler<68>, Filler<69>>>().size() == 68);
+        for (const EntityHandle entity : scene.getWith<Filler<69>, Without<Filler<68>>>()) {
+            CHECK(scene.get<Position>(entity).x == scene.get<Filler<69>>(entity).value);
+            CHECK(scene.get<Position>(entity).x % 2 == 0);
+            CHECK(scene.get<Position>(entity).x % 3 != 0);
+        }
+    });
+}
+#endif